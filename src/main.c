@@ -1,14 +1,27 @@
 #define _DEFAULT_SOURCE // Needed for getline() function
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <errno.h>
+#include <math.h>
 #include <unistd.h>
 #include <termios.h>
 #include <pthread.h>
 #include <sys/param.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #include "raylib.h"
 
 typedef enum {
@@ -18,362 +31,5961 @@ typedef enum {
     EX_ARGUMENT_PARSE_ERROR = 102,
     EX_INPUT_READ_ERROR     = 104,
     EX_SHOW_USAGE           = 105,
+    EX_THREAD_ERROR         = 106,
+    EX_PATTERN_PARSE_ERROR  = 107,
+    EX_SNAPSHOT_ERROR       = 108,
+    EX_METRICS_ERROR        = 109,
+    EX_FRAME_DUMP_ERROR     = 110,
+    EX_SELF_TEST_FAILED     = 111,
 } Exit_Codes;
 
 #define UNUSED(x) (void)(x)
 
 #define ARR_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
 
+#define CLAMP(x, low, high) MIN(MAX((x), (low)), (high))
+
 #define PRINT_ERR_LOC(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt, __FILE__, __LINE__ __VA_OPT__(,) __VA_ARGS__)
 #define PRINT_ERR(fmt, ...) fprintf(stderr, "[ERROR] " fmt __VA_OPT__(,) __VA_ARGS__)
+#define PRINT_WARN(fmt, ...) fprintf(stderr, "[WARNING] " fmt __VA_OPT__(,) __VA_ARGS__)
 
 #define CELL_ARRAY_BOUNDS_CHECK(grid, row, col)                                      \
-    if (row > grid.rows) {                                                           \
+    if (row >= grid.rows) {                                                          \
         PRINT_ERR_LOC("Cell Array index out of range! Y Coordinate is too big.\n");  \
         cell_array_free(grid);                                                       \
         exit(EX_ARR_OUT_OF_RANGE);                                                   \
     }                                                                                \
-    if (col > grid.cols) {                                                           \
+    if (col >= grid.cols) {                                                          \
         PRINT_ERR_LOC("Cell Array index out of range! X Coordinate is too big.\n");  \
         cell_array_free(grid);                                                       \
         exit(EX_ARR_OUT_OF_RANGE);                                                   \
     }
 
 #define CELL_ARRAY_PTR_BOUNDS_CHECK(grid, row, col)                                  \
-    if (row > grid->rows) {                                                          \
+    if (row >= grid->rows) {                                                         \
         PRINT_ERR_LOC("Cell Array index out of range! Y Coordinate is too big.\n");  \
         cell_array_free_ptr(grid);                                                   \
         exit(EX_ARR_OUT_OF_RANGE);                                                   \
     }                                                                                \
-    if (col > grid->cols) {                                                          \
+    if (col >= grid->cols) {                                                         \
         PRINT_ERR_LOC("Cell Array index out of range! X Coordinate is too big.\n");  \
         cell_array_free_ptr(grid);                                                   \
         exit(EX_ARR_OUT_OF_RANGE);                                                   \
     }
 
+// Rows start on a cache line so neighboring rows never share one and SIMD loads are aligned.
+#define CELL_ARRAY_ALIGNMENT 64
+
 /**
 *  A 2d array of cells.
+*
+*  All cells live in one contiguous buffer. Row `row` starts at `cells[row * stride]`,
+*  `stride` is `cols + 2` rounded up to `CELL_ARRAY_ALIGNMENT`.
+*
+*  The cells are surrounded by a ghost border one cell wide, so rows -1 and `rows` and
+*  columns -1 and `cols` can be read like any other cell. Column -1 of a row is the last
+*  byte of the padding of the row before it. The border is 0 unless `cell_array_fill_halo`
+*  fills it.
 */
 typedef struct {
-    bool **cells;
+    bool *cells;
     size_t cols;
     size_t rows;
+    size_t stride;
+    // Start of the buffer, before the ghost rows.
+    bool *allocation;
 } Cell_Array_2d;
 
+// Number of Cell Arrays allocated so far. Stepping a `Simulation` must never increase it.
+static size_t cell_array_allocation_count = 0;
+// Number of heap allocations for cells so far: grids, Sparse chunks and Hashlife nodes and
+// the tables that find them. `--stats` reports how many stepping makes.
+static _Atomic uint64_t engine_allocation_count = 0;
+
+static inline void count_engine_allocation(void) {
+    atomic_fetch_add_explicit(&engine_allocation_count, 1, memory_order_relaxed);
+}
+
 Cell_Array_2d cell_array_init(const size_t rows, const size_t cols) {
-    Cell_Array_2d cell_array = {
-        .cells = malloc(sizeof(bool*) * rows),
-        .rows = rows,
-        .cols = cols,
-    };
-    if (cell_array.cells == NULL) {
-        PRINT_ERR_LOC("Failed allocating memory for a Cell Array!");
+    // Room for the ghost columns at -1 and `cols`.
+    const size_t stride = (cols + 2 + CELL_ARRAY_ALIGNMENT - 1) / CELL_ARRAY_ALIGNMENT * CELL_ARRAY_ALIGNMENT;
+    if (stride < cols || rows > SIZE_MAX / stride / sizeof(bool) - 3) {
+        PRINT_ERR_LOC("Cell Array of %zu rows by %zu columns is too big!\n", rows, cols);
         exit(EX_MEMORY_ALLOCATION);
     }
-    for (size_t row = 0; row < rows; row++) {
-        cell_array.cells[row] = malloc(sizeof(cell_array.cells[0]) * cols);
-
-        if (cell_array.cells[row] == NULL) {
-            // Free previously allocated rows.
-            for (size_t y_old = 0; y_old < row; y_old++) {
-                free(cell_array.cells[y_old]);
-            }
-            free(cell_array.cells);
+    // The ghost rows, and before them one more cache line for column -1 of ghost row -1.
+    // aligned_alloc wants a size that is a multiple of the alignment, which every stride is.
+    const size_t size = CELL_ARRAY_ALIGNMENT + (rows + 2) * stride * sizeof(bool);
 
-            PRINT_ERR_LOC("Failed allocating memory for a Cell Array!");
-            exit(EX_MEMORY_ALLOCATION);
-        }
+    bool *allocation = aligned_alloc(CELL_ARRAY_ALIGNMENT, size);
+    if (allocation == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Cell Array!\n");
+        exit(EX_MEMORY_ALLOCATION);
     }
+    Cell_Array_2d cell_array = {
+        .cells = allocation + CELL_ARRAY_ALIGNMENT + stride,
+        .rows = rows,
+        .cols = cols,
+        .stride = stride,
+        .allocation = allocation,
+    };
 
-    for (size_t row = 0; row < rows; row++) {
-        for (size_t col = 0; col < cols; col++) {
-            cell_array.cells[row][col] = false;
-        }
-    }
+    memset(allocation, false, size);
+    cell_array_allocation_count++;
+    count_engine_allocation();
 
     return cell_array;
 }
 
 void cell_array_free(Cell_Array_2d cell_array) {
-    for (size_t idx = 0; idx < cell_array.rows; idx++) {
-        free(cell_array.cells[idx]);
-    }
-    free(cell_array.cells);
+    free(cell_array.allocation);
     cell_array.cols = 0;
     cell_array.rows = 0;
+    cell_array.stride = 0;
 }
 
 void cell_array_free_ptr(Cell_Array_2d *cell_array) {
-    for (size_t idx = 0; idx < cell_array->rows; idx++) {
-        free(cell_array->cells[idx]);
-    }
-    free(cell_array->cells);
+    free(cell_array->allocation);
+    cell_array->allocation = NULL;
+    cell_array->cells = NULL;
     cell_array->cols = 0;
     cell_array->rows = 0;
-    cell_array = NULL;
+    cell_array->stride = 0;
+}
+
+/**
+*   # Returns
+*
+*   A pointer to the first cell of `row`. Does no bounds checking.
+*/
+static inline bool *cell_array_row(const Cell_Array_2d cell_array, const size_t row) {
+    return &cell_array.cells[row * cell_array.stride];
 }
 
 bool cell_array_get(const Cell_Array_2d cell_array, const size_t row, const size_t col) {
     CELL_ARRAY_BOUNDS_CHECK(cell_array, row, col);
 
-    return cell_array.cells[row][col];
+    return cell_array.cells[row * cell_array.stride + col];
 }
 
 void cell_array_set(Cell_Array_2d *cell_array, const size_t row, const size_t col, const bool value) {
     CELL_ARRAY_PTR_BOUNDS_CHECK(cell_array, row, col);
 
-    cell_array->cells[row][col] = value;
+    cell_array->cells[row * cell_array->stride + col] = value;
+}
+
+/**
+*   Copies the opposite edges of the grid into its ghost border, so the cells on the edges
+*   see each other as neighbors like on a torus.
+*/
+void cell_array_fill_halo(const Cell_Array_2d cell_array) {
+    if (cell_array.rows == 0 || cell_array.cols == 0) {
+        return;
+    }
+
+    for (size_t row = 0; row < cell_array.rows; row++) {
+        bool *cells = cell_array_row(cell_array, row);
+        cells[-1] = cells[cell_array.cols - 1];
+        cells[cell_array.cols] = cells[0];
+    }
+
+    // Whole rows including their ghost columns, which fills the corners.
+    const size_t length = cell_array.cols + 2;
+    bool *first = cell_array_row(cell_array, 0) - 1;
+    bool *last = cell_array_row(cell_array, cell_array.rows - 1) - 1;
+    memcpy(first - cell_array.stride, last, length);
+    memcpy(last + cell_array.stride, first, length);
 }
 
 uint8_t cell_array_alive_neighbor_count(const Cell_Array_2d cell_array, const size_t row, const size_t col) {
     CELL_ARRAY_BOUNDS_CHECK(cell_array, row, col);
 
-    const int32_t indices[8][2] = {
-        {row, col - 1}, // Left
-        {row, col + 1}, // Right
-        {row - 1, col}, // Top
-        {row - 1, col - 1}, // Left-Top
-        {row - 1, col + 1}, // Right-Top
-        {row + 1, col}, // Bottom
-        {row + 1, col - 1}, // Left-Bottom
-        {row + 1, col + 1}, // Right-Bottom
-    };
+    // Cells on the edges have their missing neighbors in the ghost border.
+    const bool *center = &cell_array_row(cell_array, row)[col];
+    const bool *above = center - cell_array.stride;
+    const bool *below = center + cell_array.stride;
 
-    uint8_t alive_neighbor_count = 0;
-    for (size_t i = 0; i < ARR_LEN(indices); i++) {
-        // Validate indices
-        const int32_t row_idx = indices[i][0];
-        const int32_t col_idx = indices[i][1];
+    return above[-1] + above[0] + above[1] +
+           center[-1]            + center[1] +
+           below[-1] + below[0] + below[1];
+}
 
-        if (row_idx < 0 || col_idx < 0) {
-            continue;
-        }
-        const size_t row_idx_unsigned = row_idx;
-        const size_t col_idx_unsigned = col_idx;
+/**
+*  A Life-like rule in B/S notation, like B3/S23 for Conway's Game of Life.
+*
+*  Bit `n` of `birth` is set when a dead cell with `n` alive neighbors comes alive and
+*  bit `n` of `survival` when an alive cell with `n` alive neighbors stays alive.
+*/
+typedef struct {
+    uint16_t birth;
+    uint16_t survival;
+} Rule;
+
+#define RULE_BIT(n) (1 << (n))
+#define RULE_CONWAY ((Rule){ .birth = RULE_BIT(3), .survival = RULE_BIT(2) | RULE_BIT(3) })
+// "B012345678/S012345678" and the terminating 0
+#define RULE_STRING_SIZE 22
+
+// Rules with kernels specialized at compile time, other rules use generic kernels reading `life_rule`.
+#define SPECIALIZED_RULES(X)                                                                          \
+    X(conway,        RULE_CONWAY)                                                                     \
+    X(highlife,      ((Rule){ .birth = RULE_BIT(3) | RULE_BIT(6), .survival = RULE_BIT(2) | RULE_BIT(3) })) \
+    X(seeds,         ((Rule){ .birth = RULE_BIT(2), .survival = 0 }))                                \
+    X(day_and_night, ((Rule){                                                                         \
+        .birth = RULE_BIT(3) | RULE_BIT(6) | RULE_BIT(7) | RULE_BIT(8),                               \
+        .survival = RULE_BIT(3) | RULE_BIT(4) | RULE_BIT(6) | RULE_BIT(7) | RULE_BIT(8)                \
+    }))
+
+// The rule everything steps with, set once at startup by `rule_select`.
+static Rule life_rule = RULE_CONWAY;
+// `life_rule` as a lookup table indexed by [alive][alive neighbor count].
+// Rows are padded to 16 so they can be used by vector shuffles.
+static uint8_t rule_table[2][16] = { [0][3] = 1, [1][2] = 1, [1][3] = 1 };
+
+static inline bool rule_equals(const Rule a, const Rule b) {
+    return a.birth == b.birth && a.survival == b.survival;
+}
 
-        if (row_idx_unsigned >= cell_array.rows || col_idx_unsigned >= cell_array.cols) {
-            continue;
-        }
+// Without B0 empty space stays empty, which the unbounded engines rely on.
+static inline bool rule_keeps_empty_dead(const Rule rule) {
+    return (rule.birth & RULE_BIT(0)) == 0;
+}
 
-        // Index is valid -> check if alive
-        if (cell_array_get(cell_array, row_idx_unsigned, col_idx_unsigned) == true) {
-            alive_neighbor_count++;
-        }
-    }
+/**
+*   Parses a rule like "B36/S23", the letters can also be lower case.
+*
+*   # Returns
+*
+*   If `text` was a valid rule.
+*/
+bool rule_parse(const char *text, Rule *rule) {
+    Rule parsed = { .birth = 0, .survival = 0 };
 
-    return alive_neighbor_count;
-}
+    if (*text != 'B' && *text != 'b') {
+        return false;
+    }
+    text++;
+    for (; *text >= '0' && *text <= '8'; text++) {
+        parsed.birth |= RULE_BIT(*text - '0');
+    }
 
-typedef enum {
-    COLOR_SCHEME_DEFAULT = 0,
-    COLOR_SCHEME_HACKER  = 1,
-} Color_Scheme;
-#define COLOR_SCHEME_COUNT (COLOR_SCHEME_HACKER - COLOR_SCHEME_DEFAULT) + 1
+    if (text[0] != '/' || (text[1] != 'S' && text[1] != 's')) {
+        return false;
+    }
+    text += 2;
+    for (; *text >= '0' && *text <= '8'; text++) {
+        parsed.survival |= RULE_BIT(*text - '0');
+    }
 
-const char *color_scheme_to_string(const Color_Scheme color_scheme) {
-    switch (color_scheme) {
-        case COLOR_SCHEME_DEFAULT: return "default";
-        case COLOR_SCHEME_HACKER:  return "hacker";
+    if (*text != '\0') {
+        return false;
     }
-    return "";
+    *rule = parsed;
+    return true;
 }
 
-void cell_array_print(const Cell_Array_2d cell_array, const Color_Scheme color_scheme) {
-    for (size_t row = 0; row < cell_array.rows; row++) {
-        for (size_t col = 0; col < cell_array.cols; col++) {
-            char empty_cell = '.';
-            switch (color_scheme) {
-                case COLOR_SCHEME_DEFAULT: empty_cell = '.'; break;
-                case COLOR_SCHEME_HACKER:  empty_cell = ' '; break;
-            }
-
-            printf("%c", cell_array_get(cell_array, row, col) ? 'X' : empty_cell);
+void rule_to_string(const Rule rule, char string[RULE_STRING_SIZE]) {
+    size_t length = 0;
+    string[length++] = 'B';
+    for (uint8_t n = 0; n <= 8; n++) {
+        if (rule.birth & RULE_BIT(n)) {
+            string[length++] = '0' + n;
         }
-        printf("\n");
     }
+    string[length++] = '/';
+    string[length++] = 'S';
+    for (uint8_t n = 0; n <= 8; n++) {
+        if (rule.survival & RULE_BIT(n)) {
+            string[length++] = '0' + n;
+        }
+    }
+    string[length] = '\0';
 }
 
-void erase_screen(void) {
-    printf("\x1B[2J");
+bool cell_next_state(const bool alive, const uint8_t alive_neighbor_count) {
+    return rule_table[alive][alive_neighbor_count];
 }
 
-void enable_raw_mode() {
-    // https://viewsourcecode.org/snaptoken/kilo/02.enteringRawMode.html
-    struct termios new_termios;
+#define BIT_ARRAY_BOUNDS_CHECK(grid, row, col)                                       \
+    if (row >= grid.rows) {                                                          \
+        PRINT_ERR_LOC("Bit Array index out of range! Y Coordinate is too big.\n");   \
+        exit(EX_ARR_OUT_OF_RANGE);                                                   \
+    }                                                                                \
+    if (col >= grid.cols) {                                                          \
+        PRINT_ERR_LOC("Bit Array index out of range! X Coordinate is too big.\n");   \
+        exit(EX_ARR_OUT_OF_RANGE);                                                   \
+    }
 
-    tcgetattr(STDIN_FILENO, &new_termios);
+#define BIT_ARRAY_WORD_BITS 64
 
-    // Disable Echoing and Canonical mode
-    new_termios.c_lflag &= (~ECHO & ~ICANON);
+/**
+*  A 2d array of cells packed 64 to a `uint64_t`.
+*
+*  Column `col` of a row is bit `col % 64` of word `col / 64`. Bits past `cols` in the
+*  last word of a row are always 0.
+*/
+typedef struct {
+    uint64_t *words;
+    size_t cols;
+    size_t rows;
+    size_t words_per_row;
+} Bit_Array_2d;
 
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &new_termios);
+/**
+*  The smallest rectangle around a set of alive cells, empty while `min_row > max_row`.
+*/
+typedef struct {
+    int64_t min_row;
+    int64_t min_col;
+    int64_t max_row;
+    int64_t max_col;
+} Bounding_Box;
+
+#define BOUNDING_BOX_EMPTY ((Bounding_Box){ .min_row = INT64_MAX, .min_col = INT64_MAX, .max_row = INT64_MIN, .max_col = INT64_MIN })
+
+// What changed in the cells one worker stepped, and where the alive ones among them are now.
+typedef struct {
+    uint64_t births;
+    uint64_t deaths;
+    Bounding_Box box;
+} Generation_Counts;
+
+#define GENERATION_COUNTS_EMPTY ((Generation_Counts){ .births = 0, .deaths = 0, .box = BOUNDING_BOX_EMPTY })
+
+static inline void bounding_box_merge(Bounding_Box *box, const Bounding_Box other) {
+    box->min_row = MIN(box->min_row, other.min_row);
+    box->min_col = MIN(box->min_col, other.min_col);
+    box->max_row = MAX(box->max_row, other.max_row);
+    box->max_col = MAX(box->max_col, other.max_col);
 }
 
-void cursor_visible(const bool visible) {
-    if (visible) {
-        printf("\x1B[?25h\n");
-    } else {
-        printf("\x1B[?25l\n");
+// Grows `box` to the alive cells of the word of cells in row `row` starting at column `col`.
+static inline void bounding_box_add_word(Bounding_Box *box, const uint64_t word, const int64_t row, const int64_t col) {
+    if (word != 0) {
+        box->min_row = MIN(box->min_row, row);
+        box->max_row = MAX(box->max_row, row);
+        box->min_col = MIN(box->min_col, col + __builtin_ctzll(word));
+        box->max_col = MAX(box->max_col, col + BIT_ARRAY_WORD_BITS - 1 - __builtin_clzll(word));
     }
 }
 
-void cursor_move_home(void) { printf("\x1B[H"); }
+// Grows `box` to the alive cells of the words `[word_begin, word_end)` of row `row`.
+static inline void bounding_box_add_words(
+    Bounding_Box *box, const uint64_t *words, const size_t row, size_t word_begin, size_t word_end
+) {
+    // Only the outermost alive words of the row can widen the bounding box.
+    while (word_begin < word_end && words[word_begin] == 0) {
+        word_begin++;
+    }
+    while (word_end > word_begin && words[word_end - 1] == 0) {
+        word_end--;
+    }
+    if (word_begin < word_end) {
+        bounding_box_add_word(box, words[word_begin], row, word_begin * BIT_ARRAY_WORD_BITS);
+        bounding_box_add_word(box, words[word_end - 1], row, (word_end - 1) * BIT_ARRAY_WORD_BITS);
+    }
+}
 
-void cursor_move(const uint32_t x, const uint32_t y) { printf("\x1B[%d;%dH", y, x); }
+/**
+*   Grows `box` to the alive cells among the bool cells `[col_begin, col_end)` of row `row`,
+*   at least one of which has to be alive.
+*/
+static inline void bounding_box_add_cells(
+    Bounding_Box *box, const bool *cells, const size_t row, const size_t col_begin, const size_t col_end
+) {
+    box->min_row = MIN(box->min_row, (int64_t)row);
+    box->max_row = MAX(box->max_row, (int64_t)row);
+
+    // Only alive cells left or right of the bounding box so far can widen it, so once it
+    // spans a busy grid nothing is searched anymore.
+    // These are mostly a few cells, too few to be worth calling `memchr`.
+    const size_t left_end = CLAMP(box->min_col, (int64_t)col_begin, (int64_t)col_end);
+    size_t begin = col_begin;
+    while (left_end - begin >= sizeof(uint64_t)) {
+        uint64_t bytes;
+        memcpy(&bytes, &cells[begin], sizeof(uint64_t));
+        if (bytes != 0) {
+            break;
+        }
+        begin += sizeof(uint64_t);
+    }
+    while (begin < left_end && !cells[begin]) {
+        begin++;
+    }
+    if (begin < left_end) {
+        box->min_col = begin;
+    }
 
-void change_fg_color(const uint8_t color) { printf("\x1B[38;5;%dm", color); }
+    const size_t right_begin = CLAMP(box->max_col + 1, (int64_t)col_begin, (int64_t)col_end);
+    size_t end = col_end;
+    while (end - right_begin >= sizeof(uint64_t)) {
+        uint64_t bytes;
+        memcpy(&bytes, &cells[end - sizeof(uint64_t)], sizeof(uint64_t));
+        if (bytes != 0) {
+            break;
+        }
+        end -= sizeof(uint64_t);
+    }
+    while (end > right_begin && !cells[end - 1]) {
+        end--;
+    }
+    if (end > right_begin) {
+        box->max_col = end - 1;
+    }
+}
 
-void change_bg_color(const uint8_t color) { printf("\x1B[48;5;%dm", color); }
+Bit_Array_2d bit_array_init(const size_t rows, const size_t cols) {
+    const size_t words_per_row = (cols + BIT_ARRAY_WORD_BITS - 1) / BIT_ARRAY_WORD_BITS;
+    if (words_per_row != 0 && rows > SIZE_MAX / words_per_row / sizeof(uint64_t)) {
+        PRINT_ERR_LOC("Bit Array of %zu rows by %zu columns is too big!\n", rows, cols);
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    const size_t size = rows * words_per_row * sizeof(uint64_t);
+    const size_t aligned_size = MAX((size + CELL_ARRAY_ALIGNMENT - 1) / CELL_ARRAY_ALIGNMENT * CELL_ARRAY_ALIGNMENT, CELL_ARRAY_ALIGNMENT);
 
-void clear_color(void) { printf("\x1B[0m"); }
+    Bit_Array_2d bit_array = {
+        .words = aligned_alloc(CELL_ARRAY_ALIGNMENT, aligned_size),
+        .rows = rows,
+        .cols = cols,
+        .words_per_row = words_per_row,
+    };
+    if (bit_array.words == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Bit Array!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
 
-static bool running = true;
+    memset(bit_array.words, 0, aligned_size);
+    cell_array_allocation_count++;
+    count_engine_allocation();
 
-void ctrlc_handler(int _signum) {
-    UNUSED(_signum);
-    running = false;
+    return bit_array;
 }
 
-// Catches the CTRL+C signal and calls the `ctrlc_handler` function.
-// NOTE: $ man 2 sigaction
-void setup_ctrlc_handler(void) {
-    struct sigaction sa;
-    memset(&sa, 0, sizeof(struct sigaction));
-    sa.sa_handler = ctrlc_handler;
-    sa.sa_flags = 0;
+void bit_array_free_ptr(Bit_Array_2d *bit_array) {
+    free(bit_array->words);
+    bit_array->words = NULL;
+    bit_array->cols = 0;
+    bit_array->rows = 0;
+    bit_array->words_per_row = 0;
+}
 
-    sigaction(SIGINT, &sa, NULL);
-    sigaction(SIGTERM, &sa, NULL);
+static inline uint64_t *bit_array_row(const Bit_Array_2d bit_array, const size_t row) {
+    return &bit_array.words[row * bit_array.words_per_row];
 }
 
-void *check_input_terminal(void *_vargp) {
-    UNUSED(_vargp);
-    const char input = getchar();
+bool bit_array_get(const Bit_Array_2d bit_array, const size_t row, const size_t col) {
+    BIT_ARRAY_BOUNDS_CHECK(bit_array, row, col);
 
-    if (input == 'q' || input == 'Q') {
-        running = false;
+    return (bit_array_row(bit_array, row)[col / BIT_ARRAY_WORD_BITS] >> (col % BIT_ARRAY_WORD_BITS)) & 1;
+}
+
+void bit_array_set(Bit_Array_2d *bit_array, const size_t row, const size_t col, const bool value) {
+    BIT_ARRAY_BOUNDS_CHECK((*bit_array), row, col);
+
+    uint64_t *word = &bit_array_row(*bit_array, row)[col / BIT_ARRAY_WORD_BITS];
+    const uint64_t mask = UINT64_C(1) << (col % BIT_ARRAY_WORD_BITS);
+    if (value) {
+        *word |= mask;
+    } else {
+        *word &= ~mask;
     }
+}
 
-    return NULL;
+/**
+*   Mask of the valid bits in the last word of every row.
+*/
+static inline uint64_t bit_array_last_word_mask(const Bit_Array_2d bit_array) {
+    const size_t used_bits = bit_array.cols % BIT_ARRAY_WORD_BITS;
+    return used_bits == 0 ? UINT64_MAX : (UINT64_C(1) << used_bits) - 1;
 }
 
-void step(Cell_Array_2d *grid) {
-    Cell_Array_2d new_grid = cell_array_init(grid->rows, grid->cols);
-
-    for (size_t row = 0; row < grid->rows; row++) {
-        for (size_t col = 0; col < grid->cols; col++) {
-            const uint8_t alive_neighbor_count = cell_array_alive_neighbor_count(*grid, row, col);
-
-            if (cell_array_get(*grid, row, col) == true) {
-                // Alive Cell
-                switch (alive_neighbor_count) {
-                case 0:
-                case 1:
-                case 4:
-                case 5:
-                case 6:
-                case 7:
-                case 8: {
-                    // Die
-                    cell_array_set(&new_grid, row, col, false);
-                    break;
-                }
+void bit_array_pack(Bit_Array_2d *bit_array, const Cell_Array_2d cell_array) {
+    for (size_t row = 0; row < cell_array.rows; row++) {
+        const bool *cells = cell_array_row(cell_array, row);
+        uint64_t *words = bit_array_row(*bit_array, row);
 
-                case 2:
-                case 3: {
-                    // Live
-                    cell_array_set(&new_grid, row, col, true);
-                    break;
-                }
-                }
-            } else {
-                // Dead Cell
-                if (alive_neighbor_count == 3) {
-                    // Resurrect
-                    cell_array_set(&new_grid, row, col, true);
-                }
+        for (size_t word_idx = 0; word_idx < bit_array->words_per_row; word_idx++) {
+            const size_t col_start = word_idx * BIT_ARRAY_WORD_BITS;
+            const size_t col_end = MIN(col_start + BIT_ARRAY_WORD_BITS, cell_array.cols);
+
+            uint64_t word = 0;
+            for (size_t col = col_start; col < col_end; col++) {
+                word |= (uint64_t)cells[col] << (col - col_start);
             }
+            words[word_idx] = word;
         }
     }
-
-    cell_array_free(*grid);
-    *grid = new_grid;
 }
 
-void render_terminal(const Cell_Array_2d grid, const Color_Scheme color_scheme) {
-    // Clear Screen
-    cursor_move_home();
-    erase_screen();
+void bit_array_unpack(Cell_Array_2d *cell_array, const Bit_Array_2d bit_array) {
+    for (size_t row = 0; row < bit_array.rows; row++) {
+        const uint64_t *words = bit_array_row(bit_array, row);
+        bool *cells = cell_array_row(*cell_array, row);
 
-    // Print game
-    printf("Press Space to step through. Press Q to exit.\n\n");
-    switch (color_scheme) {
-        case COLOR_SCHEME_DEFAULT: break;
-        case COLOR_SCHEME_HACKER: change_bg_color(0); change_fg_color(46); break;
+        for (size_t col = 0; col < bit_array.cols; col++) {
+            cells[col] = (words[col / BIT_ARRAY_WORD_BITS] >> (col % BIT_ARRAY_WORD_BITS)) & 1;
+        }
     }
-    cell_array_print(grid, color_scheme);
-    clear_color();
 }
 
-bool is_digit(const char input) {
-    switch (input) {
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-        return true;
+/**
+*   The 4 bit alive neighbor count of 64 cells at once, bit `i` of `count[n]` is bit `n`
+*   of the count of cell `i`.
+*
+*   Every argument holds one of the 8 neighbors of all 64 cells.
+*   The neighbors are summed with a tree of half and full adders working on whole words.
+*/
+static inline void life_word_neighbor_count(
+    const uint64_t top_left, const uint64_t top, const uint64_t top_right,
+    const uint64_t left, const uint64_t right,
+    const uint64_t bottom_left, const uint64_t bottom, const uint64_t bottom_right,
+    uint64_t count[4]
+) {
+    #define HALF_ADD(sum, carry, a, b) \
+        const uint64_t sum = (a) ^ (b); \
+        const uint64_t carry = (a) & (b);
+    #define FULL_ADD(sum, carry, a, b, c)                  \
+        const uint64_t sum = (a) ^ (b) ^ (c);              \
+        const uint64_t carry = ((a) & (b)) | ((c) & ((a) ^ (b)));
+
+    // Ones and twos of each row of 3 (2 for the middle row)
+    FULL_ADD(top_ones, top_twos, top_left, top, top_right);
+    HALF_ADD(middle_ones, middle_twos, left, right);
+    FULL_ADD(bottom_ones, bottom_twos, bottom_left, bottom, bottom_right);
+
+    FULL_ADD(ones, ones_carry, top_ones, middle_ones, bottom_ones);
+    FULL_ADD(twos_sum, twos_carry, top_twos, middle_twos, bottom_twos);
+    HALF_ADD(twos, twos_sum_carry, twos_sum, ones_carry);
+    HALF_ADD(fours, eights, twos_carry, twos_sum_carry);
+
+    #undef HALF_ADD
+    #undef FULL_ADD
+
+    count[0] = ones;
+    count[1] = twos;
+    count[2] = fours;
+    count[3] = eights;
+}
+
+/**
+*   # Returns
+*
+*   The next state of 64 cells under `rule`, from their alive neighbor counts as computed by
+*   `life_word_neighbor_count` and their current state `alive`.
+*
+*   Inlined with a constant `rule` this folds down to a handful of word operations.
+*/
+static inline __attribute__((always_inline)) uint64_t life_word_apply_rule(
+    const uint64_t count[4], const uint64_t alive, const Rule rule
+) {
+    if (rule_equals(rule, RULE_CONWAY)) {
+        // B3/S23: Exactly 3 neighbors, or 2 neighbors and alive
+        return count[1] & ~count[2] & ~count[3] & (count[0] | alive);
     }
 
-    return false;
+    uint64_t next = 0;
+    #pragma GCC unroll 9
+    for (uint8_t n = 0; n <= 8; n++) {
+        const uint64_t has_n_neighbors =
+            (n & 1 ? count[0] : ~count[0]) & (n & 2 ? count[1] : ~count[1]) &
+            (n & 4 ? count[2] : ~count[2]) & (n & 8 ? count[3] : ~count[3]);
+        const uint64_t born = rule.birth & RULE_BIT(n) ? ~alive : 0;
+        const uint64_t survives = rule.survival & RULE_BIT(n) ? alive : 0;
+        next |= has_n_neighbors & (born | survives);
+    }
+    return next;
 }
 
-void set_starting_input(Cell_Array_2d *grid, const char *input, const size_t input_len) {
-    if (input_len == 0) return;
-
-    // Parse user input
-    #define PARSE_AND_SET_NUMBERS()                                 \
-        if (numbers[0].is_some && numbers[1].is_some) {             \
-            size_t positions[2] = {0};                              \
-            positions[0] = atoi(numbers[0].digits);                 \
-            positions[1] = atoi(numbers[1].digits);                 \
-            cell_array_set(grid, positions[0], positions[1], true); \
-        }
+/**
+*   # Returns
+*
+*   The next generation under `rule` of the 64 cells in `center`.
+*   The other arguments are the words to the left and right of it and the same 3 words
+*   of the rows above and below.
+*/
+static inline __attribute__((always_inline)) uint64_t life_word_next(
+    const uint64_t above_prev, const uint64_t above, const uint64_t above_next,
+    const uint64_t center_prev, const uint64_t center, const uint64_t center_next,
+    const uint64_t below_prev, const uint64_t below, const uint64_t below_next,
+    const Rule rule
+) {
+    // Bit i of a `*_left` word is the cell at column i - 1, of a `*_right` word column i + 1.
+    #define WEST(word, prev) (((word) << 1) | ((prev) >> (BIT_ARRAY_WORD_BITS - 1)))
+    #define EAST(word, next) (((word) >> 1) | ((next) << (BIT_ARRAY_WORD_BITS - 1)))
+
+    uint64_t count[4];
+    life_word_neighbor_count(
+        WEST(above, above_prev), above, EAST(above, above_next),
+        WEST(center, center_prev), EAST(center, center_next),
+        WEST(below, below_prev), below, EAST(below, below_next),
+        count
+    );
 
-    typedef struct {
-        // Up to 99_999 must be enough.
-        char digits[5];
-        bool is_some;
-    } Number_Or_None;
+    #undef WEST
+    #undef EAST
 
-    Number_Or_None numbers[2] = {}; // [0] => row, [1] => col
-    size_t number_idx = 0;
-    size_t digit_idx = 0;
-    for (size_t idx = 0; idx < input_len; idx++) {
-        char c = input[idx];
+    return life_word_apply_rule(count, center, rule);
+}
 
-        if (c == ' ') {
-            if (number_idx == 1) {
-                PARSE_AND_SET_NUMBERS();
-            }
+/**
+*   # Returns
+*
+*   Word `idx` of the row `words` as the step sees it, `idx` can be one before the first
+*   (`SIZE_MAX`) or one after the last word. Rows that do not exist are NULL.
+*
+*   Outside of the grid the cells are dead, unless `wrap` puts the cells of the other edge
+*   there: the last cell before the first word, and the first cell after the last one,
+*   which is in the padding of the last word when the columns do not fill it.
+*/
+static inline __attribute__((always_inline)) uint64_t bit_array_step_word(
+    const Bit_Array_2d grid, const uint64_t *words, const size_t idx, const bool wrap
+) {
+    const size_t last_idx = grid.words_per_row - 1;
+    const size_t last_word_cols = grid.cols % BIT_ARRAY_WORD_BITS;
 
-            number_idx = 0;
-            digit_idx = 0;
-            for (size_t i = 0; i < 2; i++) {
-                numbers[i].is_some = false;
-                for (size_t j = 0; j < 5; j++) {
-                    numbers[i].digits[j] = 0;
-                }
-            }
-            continue;
+    if (words == NULL) {
+        return 0;
+    }
+    if (idx < grid.words_per_row) {
+        if (wrap && idx == last_idx && last_word_cols != 0) {
+            return words[idx] | (words[0] & 1) << last_word_cols;
         }
+        return words[idx];
+    }
+    if (!wrap) {
+        return 0;
+    }
+    if (idx == SIZE_MAX) {
+        // Only bit 63 is looked at, the cells past the last column are 0.
+        return words[last_idx] >> ((grid.cols - 1) % BIT_ARRAY_WORD_BITS) << (BIT_ARRAY_WORD_BITS - 1);
+    }
+    return last_word_cols == 0 ? words[0] & 1 : 0;
+}
 
-        if (is_digit(c)) {
+/**
+*   Computes the next generation under `rule` of the words `[word_begin, word_end)` of one
+*   row of `grid` into `new_grid`. With `wrap` the edges of the grid are neighbors like on a torus.
+*
+*   Unless `counts` is NULL the cells that were born and died are added to it and the alive
+*   ones to its bounding box, while the old and new words are still in registers.
+*/
+static inline __attribute__((always_inline)) void bit_array_step_row_rule(
+    const Bit_Array_2d grid, Bit_Array_2d *new_grid,
+    const size_t row, const size_t word_begin, const size_t word_end,
+    const bool wrap,
+    const Rule rule,
+    Generation_Counts *counts
+) {
+    const size_t words_per_row = grid.words_per_row;
+
+    #define WORD_AT(words, idx) bit_array_step_word(grid, words, idx, wrap)
+
+    const uint64_t *above = row > 0 ? bit_array_row(grid, row - 1) : wrap ? bit_array_row(grid, grid.rows - 1) : NULL;
+    const uint64_t *center = bit_array_row(grid, row);
+    const uint64_t *below = row + 1 < grid.rows ? bit_array_row(grid, row + 1) : wrap ? bit_array_row(grid, 0) : NULL;
+    uint64_t *new_words = bit_array_row(*new_grid, row);
+
+    // `word_begin - 1` wraps around to `SIZE_MAX` for the first word.
+    uint64_t above_prev = WORD_AT(above, word_begin - 1);
+    uint64_t center_prev = WORD_AT(center, word_begin - 1);
+    uint64_t below_prev = WORD_AT(below, word_begin - 1);
+    uint64_t above_word = WORD_AT(above, word_begin);
+    uint64_t center_word = WORD_AT(center, word_begin);
+    uint64_t below_word = WORD_AT(below, word_begin);
+
+    const uint64_t last_word_mask = bit_array_last_word_mask(grid);
+    uint64_t births = 0;
+    uint64_t changed = 0;
+
+    for (size_t word_idx = word_begin; word_idx < word_end; word_idx++) {
+        const uint64_t above_next = WORD_AT(above, word_idx + 1);
+        const uint64_t center_next = WORD_AT(center, word_idx + 1);
+        const uint64_t below_next = WORD_AT(below, word_idx + 1);
+
+        const uint64_t next = life_word_next(
+            above_prev, above_word, above_next,
+            center_prev, center_word, center_next,
+            below_prev, below_word, below_next,
+            rule
+        );
+        new_words[word_idx] = next;
+        if (counts != NULL) {
+            // Every changed cell was either born or died.
+            const uint64_t changed_word = next ^ center_word;
+            births += __builtin_popcountll(changed_word & next);
+            changed += __builtin_popcountll(changed_word);
+        }
+
+        above_prev = above_word; above_word = above_next;
+        center_prev = center_word; center_word = center_next;
+        below_prev = below_word; below_word = below_next;
+    }
+
+    // Cells past the last column must stay dead or they would count as neighbors.
+    if (word_end == words_per_row && words_per_row > 0) {
+        if (counts != NULL) {
+            // They were counted above, and with `wrap` the old word holds a wrapped in cell there.
+            const uint64_t changed_word = (new_words[words_per_row - 1] ^ WORD_AT(center, words_per_row - 1)) & ~last_word_mask;
+            births -= __builtin_popcountll(changed_word & new_words[words_per_row - 1]);
+            changed -= __builtin_popcountll(changed_word);
+        }
+        new_words[words_per_row - 1] &= last_word_mask;
+    }
+
+    #undef WORD_AT
+
+    if (counts != NULL) {
+        counts->births += births;
+        counts->deaths += changed - births;
+        bounding_box_add_words(&counts->box, new_words, row, word_begin, word_end);
+    }
+}
+
+typedef void (*Bit_Row_Kernel)(
+    const Bit_Array_2d grid, Bit_Array_2d *new_grid,
+    size_t row, size_t word_begin, size_t word_end,
+    bool wrap
+);
+
+// Like `Bit_Row_Kernel` but also counts the changes of the row into `counts` for the metrics.
+typedef void (*Bit_Row_Count_Kernel)(
+    const Bit_Array_2d grid, Bit_Array_2d *new_grid,
+    size_t row, size_t word_begin, size_t word_end,
+    bool wrap,
+    Generation_Counts *counts
+);
+
+#if defined(__x86_64__) || defined(__i386__)
+// The counting kernels once more with the popcount instruction, like `words_count_changes_popcnt`.
+#define BIT_ROW_POPCNT_KERNEL(name, rule)                                                                   \
+    __attribute__((target("popcnt")))                                                                      \
+    static void bit_array_step_row_count_popcnt_##name(                                                     \
+        const Bit_Array_2d grid, Bit_Array_2d *new_grid,                                                    \
+        const size_t row, const size_t word_begin, const size_t word_end,                                   \
+        const bool wrap,                                                                                    \
+        Generation_Counts *counts                                                                           \
+    ) {                                                                                                     \
+        Generation_Counts row_counts = *counts;                                                             \
+        bit_array_step_row_rule(grid, new_grid, row, word_begin, word_end, wrap, rule, &row_counts);        \
+        *counts = row_counts;                                                                               \
+    }
+// The counting kernel of the rule `name` for this CPU.
+#define BIT_ROW_COUNT_KERNEL(name) \
+    (__builtin_cpu_supports("popcnt") ? bit_array_step_row_count_popcnt_##name : bit_array_step_row_count_##name)
+#else
+#define BIT_ROW_POPCNT_KERNEL(name, rule)
+#define BIT_ROW_COUNT_KERNEL(name) bit_array_step_row_count_##name
+#endif
+
+// One `bit_array_step_row_rule` per specialized rule plus a generic one for `life_rule`, each
+// with a counting twin that is only used while the metrics are written. The twins count into a
+// local copy, which can not be NULL, so the checks for it fold away and it stays in registers.
+#define BIT_ROW_KERNEL(name, rule)                                                                          \
+    static void bit_array_step_row_##name(                                                                  \
+        const Bit_Array_2d grid, Bit_Array_2d *new_grid,                                                    \
+        const size_t row, const size_t word_begin, const size_t word_end,                                   \
+        const bool wrap                                                                                     \
+    ) {                                                                                                     \
+        bit_array_step_row_rule(grid, new_grid, row, word_begin, word_end, wrap, rule, NULL);               \
+    }                                                                                                       \
+    static void bit_array_step_row_count_##name(                                                            \
+        const Bit_Array_2d grid, Bit_Array_2d *new_grid,                                                    \
+        const size_t row, const size_t word_begin, const size_t word_end,                                   \
+        const bool wrap,                                                                                    \
+        Generation_Counts *counts                                                                           \
+    ) {                                                                                                     \
+        Generation_Counts row_counts = *counts;                                                             \
+        bit_array_step_row_rule(grid, new_grid, row, word_begin, word_end, wrap, rule, &row_counts);        \
+        *counts = row_counts;                                                                               \
+    }                                                                                                       \
+    BIT_ROW_POPCNT_KERNEL(name, rule)
+SPECIALIZED_RULES(BIT_ROW_KERNEL)
+BIT_ROW_KERNEL(generic, life_rule)
+#undef BIT_ROW_KERNEL
+#undef BIT_ROW_POPCNT_KERNEL
+
+static Bit_Row_Kernel bit_row_kernel = bit_array_step_row_conway;
+static Bit_Row_Count_Kernel bit_row_count_kernel = bit_array_step_row_count_conway;
+
+/**
+*   Computes the next generation of the words `[word_begin, word_end)` of one row of `grid`
+*   into `new_grid`. With `wrap` the edges of the grid are neighbors like on a torus.
+*
+*   Unless `counts` is NULL the cells that were born and died are added to it and the alive
+*   ones to its bounding box.
+*/
+void bit_array_step_row(
+    const Bit_Array_2d grid, Bit_Array_2d *new_grid,
+    const size_t row, const size_t word_begin, const size_t word_end,
+    const bool wrap,
+    Generation_Counts *counts
+) {
+    if (counts == NULL) {
+        bit_row_kernel(grid, new_grid, row, word_begin, word_end, wrap);
+    } else {
+        bit_row_count_kernel(grid, new_grid, row, word_begin, word_end, wrap, counts);
+    }
+}
+
+/**
+*   Computes the next generation of the rows `[row_begin, row_end)` of `grid` into `new_grid`,
+*   counting the changes into `counts` unless it is NULL.
+*/
+void bit_array_step(
+    const Bit_Array_2d grid, Bit_Array_2d *new_grid,
+    const size_t row_begin, const size_t row_end,
+    const bool wrap,
+    Generation_Counts *counts
+) {
+    for (size_t row = row_begin; row < row_end; row++) {
+        bit_array_step_row(grid, new_grid, row, 0, grid.words_per_row, wrap, counts);
+    }
+}
+
+/**
+*  A node of the Hashlife quadtree.
+*
+*  A node of level `n` is a square of 2^n by 2^n cells made of 4 nodes of level `n - 1`.
+*  Level 0 nodes are single cells and have no children. Nodes are hash-consed, so two
+*  equal squares are always the same node and can be compared by pointer.
+*/
+typedef struct Hash_Node Hash_Node;
+struct Hash_Node {
+    Hash_Node *nw;
+    Hash_Node *ne;
+    Hash_Node *sw;
+    Hash_Node *se;
+    // The center half of this node `2^Hashlife.result_step_log2` generations later, NULL if not computed yet.
+    Hash_Node *result;
+    // The next node in the same hash bucket, or in the free list.
+    Hash_Node *next;
+    uint64_t population;
+    uint64_t hash;
+    uint8_t level;
+    bool marked;
+};
+
+// Enough for coordinates to fit into an int64_t.
+#define HASHLIFE_MAX_LEVEL 62
+// Default of `Hashlife.max_nodes`.
+#define HASHLIFE_MAX_NODES (1 << 22)
+#define HASHLIFE_NODE_BLOCK_SIZE 4096
+
+/**
+*  An unbounded universe stored as a Hashlife quadtree.
+*
+*  The top left cell of `root` is at (`root_row`, `root_col`), which can be negative.
+*/
+typedef struct {
+    Hash_Node *root;
+    int64_t root_row;
+    int64_t root_col;
+
+    Hash_Node dead;
+    Hash_Node alive;
+    Hash_Node *empty[HASHLIFE_MAX_LEVEL + 1];
+
+    Hash_Node **buckets;
+    size_t bucket_count;
+    size_t node_count;
+    // Past this many nodes unreachable ones are collected between advances.
+    size_t max_nodes;
+    uint8_t result_step_log2;
+
+    // Nodes are allocated in blocks, freed nodes go back to `free_nodes`.
+    Hash_Node **blocks;
+    size_t block_count;
+    size_t block_used;
+    Hash_Node *free_nodes;
+} Hashlife;
+
+static inline uint64_t hashlife_hash(const Hash_Node *nw, const Hash_Node *ne, const Hash_Node *sw, const Hash_Node *se) {
+    uint64_t hash = (uintptr_t)nw;
+    hash = hash * 0x9E3779B97F4A7C15 + (uintptr_t)ne;
+    hash = hash * 0x9E3779B97F4A7C15 + (uintptr_t)sw;
+    hash = hash * 0x9E3779B97F4A7C15 + (uintptr_t)se;
+    return hash ^ (hash >> 29);
+}
+
+static Hash_Node *hashlife_alloc_node(Hashlife *hashlife) {
+    if (hashlife->free_nodes != NULL) {
+        Hash_Node *node = hashlife->free_nodes;
+        hashlife->free_nodes = node->next;
+        return node;
+    }
+
+    if (hashlife->block_count == 0 || hashlife->block_used == HASHLIFE_NODE_BLOCK_SIZE) {
+        Hash_Node **blocks = realloc(hashlife->blocks, sizeof(Hash_Node*) * (hashlife->block_count + 1));
+        Hash_Node *block = blocks != NULL ? malloc(sizeof(Hash_Node) * HASHLIFE_NODE_BLOCK_SIZE) : NULL;
+        if (block == NULL) {
+            PRINT_ERR_LOC("Failed allocating memory for Hashlife nodes!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+        blocks[hashlife->block_count] = block;
+        hashlife->blocks = blocks;
+        count_engine_allocation();
+        count_engine_allocation();
+        hashlife->block_count++;
+        hashlife->block_used = 0;
+    }
+
+    return &hashlife->blocks[hashlife->block_count - 1][hashlife->block_used++];
+}
+
+static void hashlife_resize_buckets(Hashlife *hashlife, const size_t bucket_count) {
+    Hash_Node **buckets = calloc(bucket_count, sizeof(Hash_Node*));
+    if (buckets == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the Hashlife hash table!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    count_engine_allocation();
+
+    for (size_t idx = 0; idx < hashlife->bucket_count; idx++) {
+        Hash_Node *node = hashlife->buckets[idx];
+        while (node != NULL) {
+            Hash_Node *next = node->next;
+            Hash_Node **bucket = &buckets[node->hash & (bucket_count - 1)];
+            node->next = *bucket;
+            *bucket = node;
+            node = next;
+        }
+    }
+
+    free(hashlife->buckets);
+    hashlife->buckets = buckets;
+    hashlife->bucket_count = bucket_count;
+}
+
+/**
+*   # Returns
+*
+*   The one node made of the 4 given quadrants.
+*/
+Hash_Node *hashlife_join(Hashlife *hashlife, Hash_Node *nw, Hash_Node *ne, Hash_Node *sw, Hash_Node *se) {
+    const uint64_t hash = hashlife_hash(nw, ne, sw, se);
+    Hash_Node **bucket = &hashlife->buckets[hash & (hashlife->bucket_count - 1)];
+    for (Hash_Node *node = *bucket; node != NULL; node = node->next) {
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+            return node;
+        }
+    }
+
+    Hash_Node *node = hashlife_alloc_node(hashlife);
+    *node = (Hash_Node) {
+        .nw = nw,
+        .ne = ne,
+        .sw = sw,
+        .se = se,
+        .result = NULL,
+        .next = *bucket,
+        .population = nw->population + ne->population + sw->population + se->population,
+        .hash = hash,
+        .level = nw->level + 1,
+        .marked = false,
+    };
+    *bucket = node;
+    hashlife->node_count++;
+
+    if (hashlife->node_count > hashlife->bucket_count) {
+        hashlife_resize_buckets(hashlife, hashlife->bucket_count * 2);
+    }
+
+    return node;
+}
+
+Hash_Node *hashlife_empty(Hashlife *hashlife, const uint8_t level) {
+    if (hashlife->empty[level] == NULL) {
+        Hash_Node *quadrant = hashlife_empty(hashlife, level - 1);
+        hashlife->empty[level] = hashlife_join(hashlife, quadrant, quadrant, quadrant, quadrant);
+    }
+    return hashlife->empty[level];
+}
+
+Hashlife *hashlife_init(const uint8_t level) {
+    Hashlife *hashlife = malloc(sizeof(Hashlife));
+    if (hashlife == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for Hashlife!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    *hashlife = (Hashlife) {
+        .root = NULL,
+        .root_row = 0,
+        .root_col = 0,
+        .dead = { .population = 0, .level = 0 },
+        .alive = { .population = 1, .level = 0 },
+        .empty = { NULL },
+        .buckets = NULL,
+        .bucket_count = 0,
+        .node_count = 0,
+        .max_nodes = HASHLIFE_MAX_NODES,
+        .result_step_log2 = 0,
+        .blocks = NULL,
+        .block_count = 0,
+        .block_used = 0,
+        .free_nodes = NULL,
+    };
+    hashlife->empty[0] = &hashlife->dead;
+    hashlife_resize_buckets(hashlife, 1 << 10);
+
+    hashlife->root = hashlife_empty(hashlife, level);
+
+    return hashlife;
+}
+
+void hashlife_free(Hashlife *hashlife) {
+    for (size_t idx = 0; idx < hashlife->block_count; idx++) {
+        free(hashlife->blocks[idx]);
+    }
+    free(hashlife->blocks);
+    free(hashlife->buckets);
+    free(hashlife);
+}
+
+/**
+*   # Returns
+*
+*   The node one level above `node` with `node` in its center. Its top left is
+*   2^(level - 1) cells up and left of the one of `node`, where `level` is the one of `node`.
+*/
+Hash_Node *hashlife_expand(Hashlife *hashlife, Hash_Node *node) {
+    Hash_Node *empty = hashlife_empty(hashlife, node->level - 1);
+    return hashlife_join(
+        hashlife,
+        hashlife_join(hashlife, empty, empty, empty, node->nw),
+        hashlife_join(hashlife, empty, empty, node->ne, empty),
+        hashlife_join(hashlife, empty, node->sw, empty, empty),
+        hashlife_join(hashlife, node->se, empty, empty, empty)
+    );
+}
+
+void hashlife_expand_root(Hashlife *hashlife) {
+    if (hashlife->root->level >= HASHLIFE_MAX_LEVEL) {
+        PRINT_ERR("The Hashlife universe grew too big!\n");
+        exit(EX_ARR_OUT_OF_RANGE);
+    }
+
+    const int64_t offset = INT64_C(1) << (hashlife->root->level - 1);
+    hashlife->root = hashlife_expand(hashlife, hashlife->root);
+    hashlife->root_row -= offset;
+    hashlife->root_col -= offset;
+}
+
+// Path-copies `node` with the cell at (`row`, `col`) relative to its top left set to `value`.
+static Hash_Node *hashlife_node_set(Hashlife *hashlife, Hash_Node *node, const uint64_t row, const uint64_t col, const bool value) {
+    if (node->level == 0) {
+        return value ? &hashlife->alive : &hashlife->dead;
+    }
+
+    const uint64_t half = UINT64_C(1) << (node->level - 1);
+    Hash_Node *quadrants[4] = { node->nw, node->ne, node->sw, node->se };
+    const size_t quadrant = (row >= half) * 2 + (col >= half);
+    quadrants[quadrant] = hashlife_node_set(hashlife, quadrants[quadrant], row % half, col % half, value);
+
+    return hashlife_join(hashlife, quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+}
+
+void hashlife_set(Hashlife *hashlife, const int64_t row, const int64_t col, const bool value) {
+    #define ROOT_CONTAINS(row, col)                                                       \
+        ((row) >= hashlife->root_row && (col) >= hashlife->root_col                       \
+        && (uint64_t)((row) - hashlife->root_row) < (UINT64_C(1) << hashlife->root->level) \
+        && (uint64_t)((col) - hashlife->root_col) < (UINT64_C(1) << hashlife->root->level))
+
+    while (!ROOT_CONTAINS(row, col)) {
+        hashlife_expand_root(hashlife);
+    }
+    #undef ROOT_CONTAINS
+
+    hashlife->root = hashlife_node_set(hashlife, hashlife->root, row - hashlife->root_row, col - hashlife->root_col, value);
+}
+
+/**
+*   # Returns
+*
+*   The center 2x2 cells of a level 2 node one generation later.
+*/
+static Hash_Node *hashlife_step_4x4(Hashlife *hashlife, const Hash_Node *node) {
+    // Bit `row * 4 + col` is the cell at (`row`, `col`).
+    uint16_t bits = 0;
+    const Hash_Node *quadrants[4] = { node->nw, node->ne, node->sw, node->se };
+    for (size_t quadrant = 0; quadrant < 4; quadrant++) {
+        const Hash_Node *cells[4] = { quadrants[quadrant]->nw, quadrants[quadrant]->ne, quadrants[quadrant]->sw, quadrants[quadrant]->se };
+        for (size_t cell = 0; cell < 4; cell++) {
+            const size_t row = (quadrant / 2) * 2 + cell / 2;
+            const size_t col = (quadrant % 2) * 2 + cell % 2;
+            bits |= (uint16_t)cells[cell]->population << (row * 4 + col);
+        }
+    }
+
+    Hash_Node *next_cells[4];
+    for (size_t cell = 0; cell < 4; cell++) {
+        const size_t row = 1 + cell / 2;
+        const size_t col = 1 + cell % 2;
+
+        uint8_t alive_neighbor_count = 0;
+        for (size_t neighbor_row = row - 1; neighbor_row <= row + 1; neighbor_row++) {
+            for (size_t neighbor_col = col - 1; neighbor_col <= col + 1; neighbor_col++) {
+                if (neighbor_row != row || neighbor_col != col) {
+                    alive_neighbor_count += (bits >> (neighbor_row * 4 + neighbor_col)) & 1;
+                }
+            }
+        }
+
+        const bool alive = (bits >> (row * 4 + col)) & 1;
+        next_cells[cell] = cell_next_state(alive, alive_neighbor_count) ? &hashlife->alive : &hashlife->dead;
+    }
+
+    return hashlife_join(hashlife, next_cells[0], next_cells[1], next_cells[2], next_cells[3]);
+}
+
+/**
+*   # Returns
+*
+*   The center half of `node` (so one level lower) `2^step_log2` generations later.
+*   `step_log2` is at most `level - 2`, the results are memoized in the nodes.
+*/
+Hash_Node *hashlife_successor(Hashlife *hashlife, Hash_Node *node, const uint8_t step_log2) {
+    if (node->population == 0) {
+        return node->nw;
+    }
+    if (node->result != NULL) {
+        return node->result;
+    }
+
+    Hash_Node *result = NULL;
+    if (node->level == 2) {
+        result = hashlife_step_4x4(hashlife, node);
+    } else {
+        #define JOIN(nw, ne, sw, se) hashlife_join(hashlife, (nw), (ne), (sw), (se))
+        #define SUCCESSOR(node) hashlife_successor(hashlife, (node), step_log2)
+
+        Hash_Node *nw = node->nw, *ne = node->ne, *sw = node->sw, *se = node->se;
+
+        // The 9 overlapping sub squares of half the size, stepped ahead.
+        Hash_Node *c00 = SUCCESSOR(nw);
+        Hash_Node *c01 = SUCCESSOR(JOIN(nw->ne, ne->nw, nw->se, ne->sw));
+        Hash_Node *c02 = SUCCESSOR(ne);
+        Hash_Node *c10 = SUCCESSOR(JOIN(nw->sw, nw->se, sw->nw, sw->ne));
+        Hash_Node *c11 = SUCCESSOR(JOIN(nw->se, ne->sw, sw->ne, se->nw));
+        Hash_Node *c12 = SUCCESSOR(JOIN(ne->sw, ne->se, se->nw, se->ne));
+        Hash_Node *c20 = SUCCESSOR(sw);
+        Hash_Node *c21 = SUCCESSOR(JOIN(sw->ne, se->nw, sw->se, se->sw));
+        Hash_Node *c22 = SUCCESSOR(se);
+
+        if (step_log2 < node->level - 2) {
+            // The full step is already done, only take the centers.
+            result = JOIN(
+                JOIN(c00->se, c01->sw, c10->ne, c11->nw),
+                JOIN(c01->se, c02->sw, c11->ne, c12->nw),
+                JOIN(c10->se, c11->sw, c20->ne, c21->nw),
+                JOIN(c11->se, c12->sw, c21->ne, c22->nw)
+            );
+        } else {
+            // Half of the step is done, step the 4 overlapping quadrants for the other half.
+            result = JOIN(
+                SUCCESSOR(JOIN(c00, c01, c10, c11)),
+                SUCCESSOR(JOIN(c01, c02, c11, c12)),
+                SUCCESSOR(JOIN(c10, c11, c20, c21)),
+                SUCCESSOR(JOIN(c11, c12, c21, c22))
+            );
+        }
+
+        #undef JOIN
+        #undef SUCCESSOR
+    }
+
+    node->result = result;
+    return result;
+}
+
+static void hashlife_mark(Hash_Node *node) {
+    if (node == NULL || node->marked || node->level == 0) {
+        return;
+    }
+
+    node->marked = true;
+    hashlife_mark(node->nw);
+    hashlife_mark(node->ne);
+    hashlife_mark(node->sw);
+    hashlife_mark(node->se);
+}
+
+/**
+*   Frees every node that is not part of the current universe.
+*   Memoized results that were freed are forgotten, the others are kept.
+*/
+void hashlife_collect_garbage(Hashlife *hashlife) {
+    hashlife_mark(hashlife->root);
+    for (size_t level = 1; level <= HASHLIFE_MAX_LEVEL; level++) {
+        hashlife_mark(hashlife->empty[level]);
+    }
+
+    for (size_t idx = 0; idx < hashlife->bucket_count; idx++) {
+        Hash_Node **link = &hashlife->buckets[idx];
+        while (*link != NULL) {
+            Hash_Node *node = *link;
+            if (node->marked) {
+                if (node->result != NULL && !node->result->marked) {
+                    node->result = NULL;
+                }
+                link = &node->next;
+            } else {
+                *link = node->next;
+                node->next = hashlife->free_nodes;
+                hashlife->free_nodes = node;
+                hashlife->node_count--;
+            }
+        }
+    }
+
+    for (size_t idx = 0; idx < hashlife->bucket_count; idx++) {
+        for (Hash_Node *node = hashlife->buckets[idx]; node != NULL; node = node->next) {
+            node->marked = false;
+        }
+    }
+}
+
+static void hashlife_forget_results(Hashlife *hashlife) {
+    for (size_t idx = 0; idx < hashlife->bucket_count; idx++) {
+        for (Hash_Node *node = hashlife->buckets[idx]; node != NULL; node = node->next) {
+            node->result = NULL;
+        }
+    }
+}
+
+/**
+*   Advances the universe by 2^`step_log2` generations.
+*/
+void hashlife_advance_pow2(Hashlife *hashlife, const uint8_t step_log2) {
+    // Memoized results are only valid for the step size they were computed with.
+    if (step_log2 != hashlife->result_step_log2) {
+        hashlife_forget_results(hashlife);
+        hashlife->result_step_log2 = step_log2;
+    }
+
+    // All cells have to be in the center half of the root so nothing can leave the result.
+    #define ROOT_BORDER_IS_EMPTY()                                                                   \
+        (hashlife_join(                                                                              \
+            hashlife,                                                                                \
+            hashlife->root->nw->se, hashlife->root->ne->sw, hashlife->root->sw->ne, hashlife->root->se->nw \
+        )->population == hashlife->root->population)
+
+    while (hashlife->root->level < step_log2 + 2 || !ROOT_BORDER_IS_EMPTY()) {
+        hashlife_expand_root(hashlife);
+    }
+    #undef ROOT_BORDER_IS_EMPTY
+    // Then one more so the cells have 2^step_log2 cells of room in every direction.
+    hashlife_expand_root(hashlife);
+
+    const int64_t offset = INT64_C(1) << (hashlife->root->level - 2);
+    hashlife->root = hashlife_successor(hashlife, hashlife->root, step_log2);
+    hashlife->root_row += offset;
+    hashlife->root_col += offset;
+
+    if (hashlife->node_count > hashlife->max_nodes) {
+        hashlife_collect_garbage(hashlife);
+    }
+}
+
+void hashlife_advance(Hashlife *hashlife, const uint64_t generations) {
+    for (uint8_t step_log2 = 0; step_log2 < 64; step_log2++) {
+        if ((generations >> step_log2) & 1) {
+            hashlife_advance_pow2(hashlife, step_log2);
+        }
+    }
+}
+
+static void hashlife_node_write_cells(
+    const Hash_Node *node,
+    const int64_t row, const int64_t col,
+    Cell_Array_2d *cell_array
+) {
+    const int64_t size = INT64_C(1) << node->level;
+    if (node->population == 0
+        || row + size <= 0 || col + size <= 0
+        || row >= (int64_t)cell_array->rows || col >= (int64_t)cell_array->cols
+    ) {
+        return;
+    }
+
+    if (node->level == 0) {
+        cell_array_row(*cell_array, row)[col] = true;
+        return;
+    }
+
+    const int64_t half = size / 2;
+    hashlife_node_write_cells(node->nw, row, col, cell_array);
+    hashlife_node_write_cells(node->ne, row, col + half, cell_array);
+    hashlife_node_write_cells(node->sw, row + half, col, cell_array);
+    hashlife_node_write_cells(node->se, row + half, col + half, cell_array);
+}
+
+/**
+*   Writes the part of the universe that lies inside `cell_array`, with (0, 0) at its top left.
+*/
+void hashlife_write_cells(const Hashlife *hashlife, Cell_Array_2d *cell_array) {
+    for (size_t row = 0; row < cell_array->rows; row++) {
+        memset(cell_array_row(*cell_array, row), false, cell_array->cols);
+    }
+    hashlife_node_write_cells(hashlife->root, hashlife->root_row, hashlife->root_col, cell_array);
+}
+
+// Chunks are CHUNK_SIZE x CHUNK_SIZE cells, one word per row.
+#define CHUNK_SIZE BIT_ARRAY_WORD_BITS
+
+/**
+*  A square of cells of a `Sparse_Universe`.
+*
+*  Bit `col` of `cells[front][row]` is the cell at (`row`, `col`) relative to the top left
+*  of the chunk, which is at (`chunk_row * CHUNK_SIZE`, `chunk_col * CHUNK_SIZE`).
+*/
+typedef struct {
+    int64_t chunk_row;
+    int64_t chunk_col;
+    uint64_t cells[2][CHUNK_SIZE];
+    // Index into `Sparse_Universe.chunks`.
+    size_t idx;
+} Chunk;
+
+/**
+*  An unbounded universe made of chunks that only exist where there are alive cells.
+*
+*  Chunks are found by their coordinate through an open addressing hash table with
+*  linear probing. `chunks` lists them all for iterating. `front` selects which of the 2
+*  cell buffers of every chunk holds the current generation.
+*/
+typedef struct {
+    Chunk **slots;
+    size_t slot_count;
+
+    Chunk **chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+
+    size_t front;
+    uint64_t population;
+    // Cells of all chunks stepped so far, for the throughput of --headless.
+    uint64_t cell_updates;
+} Sparse_Universe;
+
+static inline int64_t floor_div(const int64_t value, const int64_t divisor) {
+    return value / divisor - (value % divisor < 0);
+}
+
+static inline size_t sparse_slot(const Sparse_Universe *sparse, const int64_t chunk_row, const int64_t chunk_col) {
+    uint64_t hash = (uint64_t)chunk_row * 0x9E3779B97F4A7C15 ^ (uint64_t)chunk_col;
+    hash ^= hash >> 31;
+    hash *= 0xBF58476D1CE4E5B9;
+    hash ^= hash >> 29;
+    return hash & (sparse->slot_count - 1);
+}
+
+Sparse_Universe *sparse_init(void) {
+    Sparse_Universe *sparse = malloc(sizeof(Sparse_Universe));
+    if (sparse == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Sparse Universe!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    *sparse = (Sparse_Universe) {
+        .slots = calloc(64, sizeof(Chunk*)),
+        .slot_count = 64,
+        .chunks = NULL,
+        .chunk_count = 0,
+        .chunk_capacity = 0,
+        .front = 0,
+        .population = 0,
+        .cell_updates = 0,
+    };
+    if (sparse->slots == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Sparse Universe!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    return sparse;
+}
+
+void sparse_free(Sparse_Universe *sparse) {
+    for (size_t idx = 0; idx < sparse->chunk_count; idx++) {
+        free(sparse->chunks[idx]);
+    }
+    free(sparse->chunks);
+    free(sparse->slots);
+    free(sparse);
+}
+
+Chunk *sparse_find(const Sparse_Universe *sparse, const int64_t chunk_row, const int64_t chunk_col) {
+    for (size_t slot = sparse_slot(sparse, chunk_row, chunk_col); ; slot = (slot + 1) & (sparse->slot_count - 1)) {
+        Chunk *chunk = sparse->slots[slot];
+        if (chunk == NULL) {
+            return NULL;
+        }
+        if (chunk->chunk_row == chunk_row && chunk->chunk_col == chunk_col) {
+            return chunk;
+        }
+    }
+}
+
+static void sparse_insert_slot(Sparse_Universe *sparse, Chunk *chunk) {
+    size_t slot = sparse_slot(sparse, chunk->chunk_row, chunk->chunk_col);
+    while (sparse->slots[slot] != NULL) {
+        slot = (slot + 1) & (sparse->slot_count - 1);
+    }
+    sparse->slots[slot] = chunk;
+}
+
+/**
+*   # Returns
+*
+*   The chunk at the given chunk coordinate, creating an empty one if there is none.
+*/
+Chunk *sparse_get_or_create(Sparse_Universe *sparse, const int64_t chunk_row, const int64_t chunk_col) {
+    Chunk *chunk = sparse_find(sparse, chunk_row, chunk_col);
+    if (chunk != NULL) {
+        return chunk;
+    }
+
+    // Keep the table at most half full.
+    if ((sparse->chunk_count + 1) * 2 > sparse->slot_count) {
+        free(sparse->slots);
+        sparse->slot_count *= 2;
+        sparse->slots = calloc(sparse->slot_count, sizeof(Chunk*));
+        if (sparse->slots == NULL) {
+            PRINT_ERR_LOC("Failed allocating memory for a Sparse Universe!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+        count_engine_allocation();
+        for (size_t idx = 0; idx < sparse->chunk_count; idx++) {
+            sparse_insert_slot(sparse, sparse->chunks[idx]);
+        }
+    }
+    if (sparse->chunk_count == sparse->chunk_capacity) {
+        sparse->chunk_capacity = MAX(sparse->chunk_capacity * 2, 64);
+        sparse->chunks = realloc(sparse->chunks, sizeof(Chunk*) * sparse->chunk_capacity);
+        count_engine_allocation();
+    }
+
+    chunk = calloc(1, sizeof(Chunk));
+    if (sparse->chunks == NULL || chunk == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Chunk!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    count_engine_allocation();
+    chunk->chunk_row = chunk_row;
+    chunk->chunk_col = chunk_col;
+    chunk->idx = sparse->chunk_count;
+
+    sparse->chunks[sparse->chunk_count++] = chunk;
+    sparse_insert_slot(sparse, chunk);
+
+    return chunk;
+}
+
+void sparse_evict(Sparse_Universe *sparse, Chunk *chunk) {
+    // Backward shift deletion keeps every probe sequence intact without tombstones.
+    const size_t mask = sparse->slot_count - 1;
+    size_t slot = sparse_slot(sparse, chunk->chunk_row, chunk->chunk_col);
+    while (sparse->slots[slot] != chunk) {
+        slot = (slot + 1) & mask;
+    }
+    for (size_t next = (slot + 1) & mask; sparse->slots[next] != NULL; next = (next + 1) & mask) {
+        const size_t home = sparse_slot(sparse, sparse->slots[next]->chunk_row, sparse->slots[next]->chunk_col);
+        // Move the entry back if its home is not between the hole and its current slot.
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            sparse->slots[slot] = sparse->slots[next];
+            slot = next;
+        }
+    }
+    sparse->slots[slot] = NULL;
+
+    Chunk *last = sparse->chunks[--sparse->chunk_count];
+    sparse->chunks[chunk->idx] = last;
+    last->idx = chunk->idx;
+    free(chunk);
+}
+
+void sparse_set(Sparse_Universe *sparse, const int64_t row, const int64_t col, const bool value) {
+    Chunk *chunk = sparse_get_or_create(sparse, floor_div(row, CHUNK_SIZE), floor_div(col, CHUNK_SIZE));
+    uint64_t *word = &chunk->cells[sparse->front][row - chunk->chunk_row * CHUNK_SIZE];
+    const uint64_t mask = UINT64_C(1) << (col - chunk->chunk_col * CHUNK_SIZE);
+
+    sparse->population -= (*word & mask) != 0;
+    if (value) {
+        *word |= mask;
+    } else {
+        *word &= ~mask;
+    }
+    sparse->population += value;
+}
+
+/**
+*   Sets the cells from `col_begin` up to but not including `col_end` of `row` alive, a word at a time.
+*/
+void sparse_set_alive_run(Sparse_Universe *sparse, const int64_t row, const int64_t col_begin, const int64_t col_end) {
+    const int64_t chunk_row = floor_div(row, CHUNK_SIZE);
+    for (int64_t chunk_col = floor_div(col_begin, CHUNK_SIZE); chunk_col <= floor_div(col_end - 1, CHUNK_SIZE); chunk_col++) {
+        Chunk *chunk = sparse_get_or_create(sparse, chunk_row, chunk_col);
+        uint64_t *word = &chunk->cells[sparse->front][row - chunk_row * CHUNK_SIZE];
+
+        // Unsigned differences, a run can span more than INT64_MAX columns.
+        const uint64_t first_col = (uint64_t)chunk_col * CHUNK_SIZE;
+        const uint64_t bit_begin = chunk_col == floor_div(col_begin, CHUNK_SIZE) ? (uint64_t)col_begin - first_col : 0;
+        const uint64_t bit_end = MIN((uint64_t)col_end - first_col, CHUNK_SIZE);
+        const uint64_t high_mask = bit_end == CHUNK_SIZE ? UINT64_MAX : (UINT64_C(1) << bit_end) - 1;
+        const uint64_t mask = high_mask & ~((UINT64_C(1) << bit_begin) - 1);
+
+        sparse->population += __builtin_popcountll(mask & ~*word);
+        *word |= mask;
+    }
+}
+
+/**
+*   Creates the neighbors of every chunk that alive cells on its edge could spread into.
+*/
+void sparse_create_neighbors(Sparse_Universe *sparse) {
+    // Chunks created here are empty and need no neighbors of their own.
+    const size_t chunk_count = sparse->chunk_count;
+    for (size_t idx = 0; idx < chunk_count; idx++) {
+        const Chunk *chunk = sparse->chunks[idx];
+        const uint64_t *cells = chunk->cells[sparse->front];
+        const int64_t row = chunk->chunk_row;
+        const int64_t col = chunk->chunk_col;
+
+        uint64_t left_col = 0, right_col = 0;
+        for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+            left_col |= cells[cell_row];
+        }
+        right_col = left_col >> (CHUNK_SIZE - 1);
+        left_col &= 1;
+
+        const uint64_t top = cells[0];
+        const uint64_t bottom = cells[CHUNK_SIZE - 1];
+
+        if (top != 0)                        sparse_get_or_create(sparse, row - 1, col);
+        if (bottom != 0)                     sparse_get_or_create(sparse, row + 1, col);
+        if (left_col != 0)                   sparse_get_or_create(sparse, row, col - 1);
+        if (right_col != 0)                  sparse_get_or_create(sparse, row, col + 1);
+        if (top & 1)                         sparse_get_or_create(sparse, row - 1, col - 1);
+        if (top >> (CHUNK_SIZE - 1))         sparse_get_or_create(sparse, row - 1, col + 1);
+        if (bottom & 1)                      sparse_get_or_create(sparse, row + 1, col - 1);
+        if (bottom >> (CHUNK_SIZE - 1))      sparse_get_or_create(sparse, row + 1, col + 1);
+    }
+}
+
+// Computes the next generation under `rule` of the chunks `[chunk_begin, chunk_end)` into their back buffers.
+static inline __attribute__((always_inline)) void sparse_step_chunks_rule(
+    const Sparse_Universe *sparse, const size_t chunk_begin, const size_t chunk_end, const Rule rule
+) {
+    const size_t front = sparse->front;
+    const size_t back = 1 - front;
+
+    for (size_t idx = chunk_begin; idx < chunk_end; idx++) {
+        Chunk *chunk = sparse->chunks[idx];
+        const int64_t row = chunk->chunk_row;
+        const int64_t col = chunk->chunk_col;
+
+        const Chunk *neighbors[3][3];
+        for (int64_t d_row = -1; d_row <= 1; d_row++) {
+            for (int64_t d_col = -1; d_col <= 1; d_col++) {
+                neighbors[d_row + 1][d_col + 1] = sparse_find(sparse, row + d_row, col + d_col);
+            }
+        }
+
+        // Word `cell_row` of the chunk in the given column of `neighbors`, 0 if there is no chunk.
+        #define WORD(neighbor_row, neighbor_col, cell_row)                                             \
+            (neighbors[neighbor_row][neighbor_col] != NULL                                             \
+                ? neighbors[neighbor_row][neighbor_col]->cells[front][cell_row] : 0)
+        // Word of row `cell_row - 1` or `cell_row + 1`, which can be in the chunk above or below.
+        #define ROW_ABOVE(neighbor_col, cell_row) \
+            ((cell_row) > 0 ? WORD(1, neighbor_col, (cell_row) - 1) : WORD(0, neighbor_col, CHUNK_SIZE - 1))
+        #define ROW_BELOW(neighbor_col, cell_row) \
+            ((cell_row) + 1 < CHUNK_SIZE ? WORD(1, neighbor_col, (cell_row) + 1) : WORD(2, neighbor_col, 0))
+
+        for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+            chunk->cells[back][cell_row] = life_word_next(
+                ROW_ABOVE(0, cell_row), ROW_ABOVE(1, cell_row), ROW_ABOVE(2, cell_row),
+                WORD(1, 0, cell_row), chunk->cells[front][cell_row], WORD(1, 2, cell_row),
+                ROW_BELOW(0, cell_row), ROW_BELOW(1, cell_row), ROW_BELOW(2, cell_row),
+                rule
+            );
+        }
+
+        #undef WORD
+        #undef ROW_ABOVE
+        #undef ROW_BELOW
+    }
+}
+
+typedef void (*Chunk_Kernel)(const Sparse_Universe *sparse, size_t chunk_begin, size_t chunk_end);
+
+#define CHUNK_KERNEL(name, rule)                                                                          \
+    static void sparse_step_chunks_##name(const Sparse_Universe *sparse, const size_t chunk_begin, const size_t chunk_end) { \
+        sparse_step_chunks_rule(sparse, chunk_begin, chunk_end, rule);                                    \
+    }
+SPECIALIZED_RULES(CHUNK_KERNEL)
+CHUNK_KERNEL(generic, life_rule)
+#undef CHUNK_KERNEL
+
+static Chunk_Kernel chunk_kernel = sparse_step_chunks_conway;
+static const char *rule_kernel_name = "conway";
+
+// Computes the next generation of the chunks `[chunk_begin, chunk_end)` into their back buffers.
+void sparse_step_chunks(const Sparse_Universe *sparse, const size_t chunk_begin, const size_t chunk_end) {
+    chunk_kernel(sparse, chunk_begin, chunk_end);
+}
+
+/**
+*   Makes `rule` the rule of every engine and picks the kernels specialized for it, or the
+*   generic ones if there are none. Called once at startup before `row_kernel_select`.
+*/
+void rule_select(const Rule rule) {
+    life_rule = rule;
+    memset(rule_table, 0, sizeof(rule_table));
+    for (uint8_t n = 0; n <= 8; n++) {
+        rule_table[0][n] = (rule.birth & RULE_BIT(n)) != 0;
+        rule_table[1][n] = (rule.survival & RULE_BIT(n)) != 0;
+    }
+
+    bit_row_kernel = bit_array_step_row_generic;
+    bit_row_count_kernel = BIT_ROW_COUNT_KERNEL(generic);
+    chunk_kernel = sparse_step_chunks_generic;
+    rule_kernel_name = "generic";
+
+    #define SELECT_RULE_KERNELS(name, specialized_rule)          \
+        if (rule_equals(rule, specialized_rule)) {               \
+            bit_row_kernel = bit_array_step_row_##name;          \
+            bit_row_count_kernel = BIT_ROW_COUNT_KERNEL(name);   \
+            chunk_kernel = sparse_step_chunks_##name;            \
+            rule_kernel_name = #name;                            \
+        }
+    SPECIALIZED_RULES(SELECT_RULE_KERNELS)
+    #undef SELECT_RULE_KERNELS
+}
+#undef BIT_ROW_COUNT_KERNEL
+
+/**
+*   Makes the back buffers the current generation, recounts the population and evicts
+*   chunks that died out.
+*/
+void sparse_finish_step(Sparse_Universe *sparse) {
+    sparse->front = 1 - sparse->front;
+    sparse->population = 0;
+    // Before evicting, every chunk that is there now was stepped.
+    sparse->cell_updates += (uint64_t)sparse->chunk_count * CHUNK_SIZE * CHUNK_SIZE;
+
+    // Backwards, so evicting moves an already visited chunk into the hole.
+    for (size_t idx = sparse->chunk_count; idx > 0; idx--) {
+        Chunk *chunk = sparse->chunks[idx - 1];
+        uint64_t population = 0;
+        for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+            population += __builtin_popcountll(chunk->cells[sparse->front][cell_row]);
+        }
+
+        if (population == 0) {
+            sparse_evict(sparse, chunk);
+        }
+        sparse->population += population;
+    }
+}
+
+/**
+*   Writes the part of the universe that lies inside `cell_array`, with (0, 0) at its top left.
+*/
+void sparse_write_cells(const Sparse_Universe *sparse, Cell_Array_2d *cell_array) {
+    for (size_t row = 0; row < cell_array->rows; row++) {
+        memset(cell_array_row(*cell_array, row), false, cell_array->cols);
+    }
+
+    for (size_t idx = 0; idx < sparse->chunk_count; idx++) {
+        const Chunk *chunk = sparse->chunks[idx];
+        const int64_t row_offset = chunk->chunk_row * CHUNK_SIZE;
+        const int64_t col_offset = chunk->chunk_col * CHUNK_SIZE;
+
+        for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+            const int64_t row = row_offset + cell_row;
+            if (row < 0 || row >= (int64_t)cell_array->rows) {
+                continue;
+            }
+
+            uint64_t word = chunk->cells[sparse->front][cell_row];
+            while (word != 0) {
+                const int64_t col = col_offset + __builtin_ctzll(word);
+                word &= word - 1;
+                if (col >= 0 && col < (int64_t)cell_array->cols) {
+                    cell_array_row(*cell_array, row)[col] = true;
+                }
+            }
+        }
+    }
+}
+
+typedef enum {
+    COLOR_SCHEME_DEFAULT = 0,
+    COLOR_SCHEME_HACKER  = 1,
+} Color_Scheme;
+#define COLOR_SCHEME_COUNT (COLOR_SCHEME_HACKER - COLOR_SCHEME_DEFAULT) + 1
+
+const char *color_scheme_to_string(const Color_Scheme color_scheme) {
+    switch (color_scheme) {
+        case COLOR_SCHEME_DEFAULT: return "default";
+        case COLOR_SCHEME_HACKER:  return "hacker";
+    }
+    return "";
+}
+
+void erase_screen(void) {
+    printf("\x1B[2J");
+}
+
+void enable_raw_mode() {
+    // https://viewsourcecode.org/snaptoken/kilo/02.enteringRawMode.html
+    struct termios new_termios;
+
+    tcgetattr(STDIN_FILENO, &new_termios);
+
+    // Disable Echoing and Canonical mode
+    new_termios.c_lflag &= (~ECHO & ~ICANON);
+
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &new_termios);
+}
+
+void cursor_visible(const bool visible) {
+    if (visible) {
+        printf("\x1B[?25h\n");
+    } else {
+        printf("\x1B[?25l\n");
+    }
+}
+
+void cursor_move_home(void) { printf("\x1B[H"); }
+
+void cursor_move(const uint32_t x, const uint32_t y) { printf("\x1B[%d;%dH", y, x); }
+
+void change_fg_color(const uint8_t color) { printf("\x1B[38;5;%dm", color); }
+
+void change_bg_color(const uint8_t color) { printf("\x1B[48;5;%dm", color); }
+
+void clear_color(void) { printf("\x1B[0m"); }
+
+static _Atomic bool running = true;
+
+void ctrlc_handler(int _signum) {
+    UNUSED(_signum);
+    running = false;
+}
+
+// Catches the CTRL+C signal and calls the `ctrlc_handler` function.
+// NOTE: $ man 2 sigaction
+void setup_ctrlc_handler(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_handler = ctrlc_handler;
+    sa.sa_flags = 0;
+
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+static inline uint64_t monotonic_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// Build with -DENABLE_STATS=0 to compile the instrumentation out entirely.
+#ifndef ENABLE_STATS
+#define ENABLE_STATS 1
+#endif
+
+typedef enum {
+    STATS_PHASE_STEP       = 0,
+    STATS_PHASE_PUBLISH    = 1,
+    STATS_PHASE_RENDER     = 2,
+    STATS_PHASE_DRAW       = 3,
+    STATS_PHASE_INPUT      = 4,
+    STATS_PHASE_CHECKPOINT = 5,
+    STATS_PHASE_FRAME      = 6,
+} Stats_Phase;
+
+const char *stats_phase_to_string(const Stats_Phase phase) {
+    switch (phase) {
+        case STATS_PHASE_STEP:       return "step";
+        case STATS_PHASE_PUBLISH:    return "publish";
+        case STATS_PHASE_RENDER:     return "render";
+        case STATS_PHASE_DRAW:       return "draw";
+        case STATS_PHASE_INPUT:      return "input";
+        case STATS_PHASE_CHECKPOINT: return "checkpoint";
+        case STATS_PHASE_FRAME:      return "frame";
+    }
+    return "";
+}
+
+typedef enum {
+    STATS_FORMAT_TABLE = 0,
+    STATS_FORMAT_JSON  = 1,
+} Stats_Format;
+#define STATS_FORMAT_COUNT ((STATS_FORMAT_JSON - STATS_FORMAT_TABLE) + 1)
+
+const char *stats_format_to_string(const Stats_Format format) {
+    switch (format) {
+        case STATS_FORMAT_TABLE: return "table";
+        case STATS_FORMAT_JSON:  return "json";
+    }
+    return "";
+}
+
+#if ENABLE_STATS
+
+#define STATS_PHASE_COUNT ((STATS_PHASE_FRAME - STATS_PHASE_STEP) + 1)
+
+/**
+*  A latency histogram with buckets that grow exponentially, every power of 2 is split into
+*  `STATS_SUB_BUCKETS` linear ones, so percentiles are off by at most 1 / `STATS_SUB_BUCKETS`.
+*
+*  Every phase is only ever recorded from one thread, the atomics are there so the report
+*  can read them from another one.
+*/
+#define STATS_SUB_BUCKET_BITS 3
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKET_BITS)
+#define STATS_BUCKET_COUNT ((64 - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS)
+
+typedef struct {
+    _Atomic uint64_t buckets[STATS_BUCKET_COUNT];
+    _Atomic uint64_t count;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+} Stats_Histogram;
+
+static struct {
+    bool enabled;
+    Stats_Format format;
+    Stats_Histogram phases[STATS_PHASE_COUNT];
+    _Atomic uint64_t generations;
+    _Atomic uint64_t allocations;
+    _Atomic uint64_t max_allocations_per_generation;
+    // Set by SIGUSR1, the report is printed by whoever steps the simulation next.
+    _Atomic bool report_requested;
+    uint64_t start_ns;
+} stats = {0};
+
+static inline size_t stats_bucket(const uint64_t ns) {
+    if (ns < STATS_SUB_BUCKETS) {
+        return ns;
+    }
+    const size_t msb = 63 - __builtin_clzll(ns);
+    const size_t sub_bucket = (ns >> (msb - STATS_SUB_BUCKET_BITS)) & (STATS_SUB_BUCKETS - 1);
+    return (msb - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS + sub_bucket;
+}
+
+// Largest value that falls into `bucket`.
+static inline uint64_t stats_bucket_upper_bound(const size_t bucket) {
+    if (bucket < STATS_SUB_BUCKETS) {
+        return bucket;
+    }
+    const size_t msb = bucket / STATS_SUB_BUCKETS + STATS_SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = bucket % STATS_SUB_BUCKETS;
+    const uint64_t lower_bound = (UINT64_C(1) << msb) | (sub_bucket << (msb - STATS_SUB_BUCKET_BITS));
+    return lower_bound + (UINT64_C(1) << (msb - STATS_SUB_BUCKET_BITS)) - 1;
+}
+
+// Only the thread recording a phase writes it, so a load and a store are enough.
+static inline void stats_add(_Atomic uint64_t *counter, const uint64_t value) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static inline void stats_max(_Atomic uint64_t *counter, const uint64_t value) {
+    if (value > atomic_load_explicit(counter, memory_order_relaxed)) {
+        atomic_store_explicit(counter, value, memory_order_relaxed);
+    }
+}
+
+static void stats_record(const Stats_Phase phase, const uint64_t ns) {
+    Stats_Histogram *histogram = &stats.phases[phase];
+    stats_add(&histogram->buckets[stats_bucket(ns)], 1);
+    stats_add(&histogram->count, 1);
+    stats_add(&histogram->total_ns, ns);
+    stats_max(&histogram->max_ns, ns);
+}
+
+static void stats_record_generations(const uint64_t generations, const uint64_t allocations) {
+    stats_add(&stats.generations, generations);
+    stats_add(&stats.allocations, allocations);
+    // Hashlife records whole jumps at once.
+    stats_max(&stats.max_allocations_per_generation, (allocations + generations - 1) / generations);
+}
+
+static uint64_t stats_percentile(const Stats_Histogram *histogram, const double percentile) {
+    const uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = MAX((uint64_t)ceil(count * percentile), 1);
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < STATS_BUCKET_COUNT; bucket++) {
+        seen += atomic_load_explicit(&histogram->buckets[bucket], memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket bound can be past the largest value that was actually recorded.
+            return MIN(stats_bucket_upper_bound(bucket), atomic_load_explicit(&histogram->max_ns, memory_order_relaxed));
+        }
+    }
+    return atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+}
+
+void stats_report_handler(int _signum) {
+    UNUSED(_signum);
+    atomic_store(&stats.report_requested, true);
+}
+
+void stats_enable(const Stats_Format format) {
+    stats.enabled = true;
+    stats.format = format;
+    stats.start_ns = monotonic_ns();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(struct sigaction));
+    sa.sa_handler = stats_report_handler;
+    // Sleeps and reads carry on instead of failing.
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+// Times the code between the two, they have to be in the same scope.
+#define STATS_BEGIN(phase) const uint64_t stats_start_##phase = stats.enabled ? monotonic_ns() : 0
+#define STATS_END(phase)                                                 \
+    if (stats.enabled) {                                                 \
+        stats_record((phase), monotonic_ns() - stats_start_##phase);     \
+    }
+
+#else
+
+#define STATS_BEGIN(phase)
+#define STATS_END(phase)
+
+#endif // ENABLE_STATS
+
+void *check_input_terminal(void *_vargp) {
+    UNUSED(_vargp);
+    const char input = getchar();
+
+    if (input == 'q' || input == 'Q') {
+        running = false;
+    }
+
+    return NULL;
+}
+
+/**
+*   A job run by every thread of a `Worker_Pool`.
+*   `worker_idx` goes from 0 to `worker_count - 1`, the calling thread is worker 0.
+*/
+typedef void (*Worker_Job)(void *data, size_t worker_idx, size_t worker_count);
+
+/**
+*  Threads that are created once and then run one job after another.
+*
+*  `start` releases the workers into the current job and `done` waits for all of them
+*  to finish it, so running a job costs two barriers and no thread creation.
+*/
+typedef struct Worker_Pool Worker_Pool;
+
+typedef struct {
+    Worker_Pool *pool;
+    size_t worker_idx;
+} Worker_Thread_Args;
+
+struct Worker_Pool {
+    pthread_t *threads;
+    Worker_Thread_Args *thread_args;
+    size_t worker_count;
+
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+
+    Worker_Job job;
+    void *job_data;
+    bool quit;
+};
+
+void *worker_pool_thread(void *vargp) {
+    const Worker_Thread_Args *args = vargp;
+    Worker_Pool *pool = args->pool;
+
+    while (true) {
+        pthread_barrier_wait(&pool->start);
+        if (pool->quit) {
+            break;
+        }
+
+        pool->job(pool->job_data, args->worker_idx, pool->worker_count);
+        pthread_barrier_wait(&pool->done);
+    }
+
+    return NULL;
+}
+
+/**
+*   # Returns
+*
+*   A pool with `worker_count - 1` threads, the thread calling `worker_pool_run` is the last worker.
+*/
+Worker_Pool *worker_pool_init(const size_t worker_count) {
+    Worker_Pool *pool = malloc(sizeof(Worker_Pool));
+    if (pool == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Worker Pool!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    *pool = (Worker_Pool) {
+        .threads = malloc(sizeof(pthread_t) * worker_count),
+        .thread_args = malloc(sizeof(Worker_Thread_Args) * worker_count),
+        .worker_count = worker_count,
+        .job = NULL,
+        .job_data = NULL,
+        .quit = false,
+    };
+    if (pool->threads == NULL || pool->thread_args == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for a Worker Pool!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    pthread_barrier_init(&pool->start, NULL, worker_count);
+    pthread_barrier_init(&pool->done, NULL, worker_count);
+
+    for (size_t idx = 1; idx < worker_count; idx++) {
+        pool->thread_args[idx] = (Worker_Thread_Args) { .pool = pool, .worker_idx = idx };
+        if (pthread_create(&pool->threads[idx], NULL, worker_pool_thread, &pool->thread_args[idx]) != 0) {
+            PRINT_ERR_LOC("Failed creating worker thread %zu!\n", idx);
+            exit(EX_THREAD_ERROR);
+        }
+    }
+
+    return pool;
+}
+
+void worker_pool_free(Worker_Pool *pool) {
+    pool->quit = true;
+    pthread_barrier_wait(&pool->start);
+    for (size_t idx = 1; idx < pool->worker_count; idx++) {
+        pthread_join(pool->threads[idx], NULL);
+    }
+
+    pthread_barrier_destroy(&pool->start);
+    pthread_barrier_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->thread_args);
+    free(pool);
+}
+
+// Runs `job` on every worker and returns once all of them are done.
+void worker_pool_run(Worker_Pool *pool, const Worker_Job job, void *job_data) {
+    pool->job = job;
+    pool->job_data = job_data;
+
+    pthread_barrier_wait(&pool->start);
+    job(job_data, 0, pool->worker_count);
+    pthread_barrier_wait(&pool->done);
+}
+
+typedef enum {
+    ENGINE_BOOL      = 0,
+    ENGINE_BITPACKED = 1,
+    ENGINE_HASHLIFE  = 2,
+    ENGINE_SPARSE    = 3,
+} Engine;
+#define ENGINE_COUNT ((ENGINE_SPARSE - ENGINE_BOOL) + 1)
+
+const char *engine_to_string(const Engine engine) {
+    switch (engine) {
+        case ENGINE_BOOL:      return "bool";
+        case ENGINE_BITPACKED: return "bitpacked";
+        case ENGINE_HASHLIFE:  return "hashlife";
+        case ENGINE_SPARSE:    return "sparse";
+    }
+    return "";
+}
+
+typedef enum {
+    CYCLE_ACTION_STOP         = 0,
+    CYCLE_ACTION_FAST_FORWARD = 1,
+} Cycle_Action;
+#define CYCLE_ACTION_COUNT ((CYCLE_ACTION_FAST_FORWARD - CYCLE_ACTION_STOP) + 1)
+
+const char *cycle_action_to_string(const Cycle_Action action) {
+    switch (action) {
+        case CYCLE_ACTION_STOP:         return "stop";
+        case CYCLE_ACTION_FAST_FORWARD: return "fast-forward";
+    }
+    return "";
+}
+
+// Generations the hashes are kept for, which is the longest period that can be found.
+#define CYCLE_HISTORY_SIZE 512
+
+/**
+*  Finds the generation where a simulation starts repeating itself, see `cycle_detector_end`.
+*
+*  Every generation is reduced to a 64 bit hash, the XOR of `word_hash` of every word of
+*  cells in it. A changed word is XORed out with its old cells and back in with the new ones,
+*  so the workers only hash the words that changed while stepping and the whole grid is
+*  hashed only once.
+*/
+typedef struct {
+    Cycle_Action action;
+    uint64_t hash;
+    // Set when cells were edited outside of `step`, the next step then hashes everything.
+    bool hash_is_stale;
+    // The hash of generation `g` is at `history[g % CYCLE_HISTORY_SIZE]`, for the last
+    // `history_length` generations.
+    uint64_t history[CYCLE_HISTORY_SIZE];
+    size_t history_length;
+    // Changes to `hash` from the cells each worker stepped in the current generation.
+    uint64_t *worker_hash_deltas;
+    size_t worker_count;
+
+    // 0 until a cycle was found. A period of 1 is a generation that no longer changes.
+    uint64_t period;
+    // The first generation of the cycle.
+    uint64_t cycle_start;
+    // Generations `CYCLE_ACTION_FAST_FORWARD` jumped over.
+    uint64_t skipped_generations;
+} Cycle_Detector;
+
+// One line of the metrics stream, for the generation that was just stepped.
+typedef struct {
+    uint64_t generation;
+    uint64_t population;
+    uint64_t births;
+    uint64_t deaths;
+    Bounding_Box box;
+    uint64_t step_ns;
+} Metrics_Record;
+
+// Records a block holds. The stepping thread only waits for the writer once per block.
+#define METRICS_BLOCK_RECORDS 4096
+
+/**
+*  Writes `Metrics_Record`s as CSV on its own thread.
+*
+*  The stepping thread fills one of the 2 blocks while the writer formats the other one,
+*  so recording a generation is a copy into memory and formatting and I/O never happen
+*  on the stepping thread. It only waits when the writer is still a whole block behind.
+*/
+typedef struct {
+    FILE *file;
+    const char *path;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    Metrics_Record *blocks[2];
+    // The block the stepping thread fills.
+    size_t block_idx;
+    size_t record_count;
+    // Handed over to the writer, NULL while it waits for the next block.
+    const Metrics_Record *pending;
+    size_t pending_count;
+    bool quit;
+} Metrics_Writer;
+
+/**
+*  Per generation metrics, see `metrics_end`.
+*
+*  The workers count the births and deaths and the bounding box of the cells they step,
+*  right after stepping them, and the population follows from the births and deaths.
+*  Only an edit outside of `step` makes the next step count everything again.
+*/
+typedef struct {
+    Metrics_Writer writer;
+    uint64_t population;
+    // Set when cells were edited outside of `step`.
+    bool is_stale;
+    Generation_Counts *worker_counts;
+    size_t worker_count;
+    // With active tiles the bounding box of every tile. Only tiles that changed are looked at again.
+    Bounding_Box *tile_boxes;
+    uint64_t step_start_ns;
+} Metrics;
+
+static void metrics_writer_write_block(Metrics_Writer *writer, const Metrics_Record *records, const size_t record_count) {
+    for (size_t idx = 0; idx < record_count; idx++) {
+        const Metrics_Record *record = &records[idx];
+        fprintf(
+            writer->file, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",",
+            record->generation, record->population, record->births, record->deaths
+        );
+        // Without alive cells there is no bounding box.
+        if (record->box.min_row <= record->box.max_row) {
+            fprintf(
+                writer->file, "%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",",
+                record->box.min_row, record->box.min_col, record->box.max_row, record->box.max_col
+            );
+        } else {
+            fputs(",,,,", writer->file);
+        }
+        fprintf(writer->file, "%" PRIu64 "\n", record->step_ns);
+    }
+}
+
+static void *metrics_writer_thread(void *args) {
+    Metrics_Writer *writer = args;
+
+    pthread_mutex_lock(&writer->lock);
+    while (true) {
+        while (writer->pending == NULL && !writer->quit) {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+        if (writer->pending == NULL) {
+            break;
+        }
+
+        const Metrics_Record *records = writer->pending;
+        const size_t record_count = writer->pending_count;
+        pthread_mutex_unlock(&writer->lock);
+        metrics_writer_write_block(writer, records, record_count);
+        pthread_mutex_lock(&writer->lock);
+
+        writer->pending = NULL;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/**
+*   Creates or truncates `path`, writes the CSV header and starts the writer thread.
+*   Exits when the file can not be opened.
+*/
+void metrics_writer_open(Metrics_Writer *writer, const char *path) {
+    *writer = (Metrics_Writer){
+        .file = fopen(path, "w"),
+        .path = path,
+        .blocks = {
+            malloc(sizeof(Metrics_Record) * METRICS_BLOCK_RECORDS),
+            malloc(sizeof(Metrics_Record) * METRICS_BLOCK_RECORDS),
+        },
+        .block_idx = 0,
+        .record_count = 0,
+        .pending = NULL,
+        .pending_count = 0,
+        .quit = false,
+    };
+    if (writer->file == NULL) {
+        PRINT_ERR("Failed opening metrics file \"%s\"!\n", path);
+        exit(EX_METRICS_ERROR);
+    }
+    if (writer->blocks[0] == NULL || writer->blocks[1] == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the metrics!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    fputs("generation,population,births,deaths,min_row,min_col,max_row,max_col,step_ns\n", writer->file);
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    if (pthread_create(&writer->thread, NULL, metrics_writer_thread, writer) != 0) {
+        PRINT_ERR("Failed creating the metrics writer thread!\n");
+        exit(EX_THREAD_ERROR);
+    }
+}
+
+// Hands the filled part of the current block to the writer and continues in the other one.
+static void metrics_writer_flush(Metrics_Writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    while (writer->pending != NULL) {
+        pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    writer->pending = writer->blocks[writer->block_idx];
+    writer->pending_count = writer->record_count;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+
+    writer->block_idx = 1 - writer->block_idx;
+    writer->record_count = 0;
+}
+
+static inline void metrics_writer_push(Metrics_Writer *writer, const Metrics_Record record) {
+    writer->blocks[writer->block_idx][writer->record_count++] = record;
+    if (writer->record_count == METRICS_BLOCK_RECORDS) {
+        metrics_writer_flush(writer);
+    }
+}
+
+/**
+*   Writes the remaining records, stops the writer thread and closes the file.
+*
+*   # Returns
+*
+*   If everything was written.
+*/
+bool metrics_writer_close(Metrics_Writer *writer) {
+    if (writer->record_count > 0) {
+        metrics_writer_flush(writer);
+    }
+    pthread_mutex_lock(&writer->lock);
+    writer->quit = true;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+    free(writer->blocks[0]);
+    free(writer->blocks[1]);
+
+    const bool failed = ferror(writer->file) != 0;
+    if (fclose(writer->file) != 0 || failed) {
+        PRINT_ERR("Failed writing metrics file \"%s\"!\n", writer->path);
+        return false;
+    }
+    return true;
+}
+
+typedef enum {
+    FRAME_FORMAT_PBM = 0,
+    FRAME_FORMAT_PGM = 1,
+} Frame_Format;
+#define FRAME_FORMAT_COUNT ((FRAME_FORMAT_PGM - FRAME_FORMAT_PBM) + 1)
+
+const char *frame_format_to_string(const Frame_Format format) {
+    switch (format) {
+        case FRAME_FORMAT_PBM: return "pbm";
+        case FRAME_FORMAT_PGM: return "pgm";
+    }
+    return "";
+}
+
+// Frames that can wait for the writer. When all are queued the stepping thread waits for one or drops the frame.
+#define FRAME_QUEUE_SIZE 4
+
+// A copy of one generation. The bitpacked engine copies its words, the other engines their cells.
+typedef struct {
+    uint64_t generation;
+    Bit_Array_2d bits;
+    Cell_Array_2d cells;
+} Frame;
+
+/**
+*  Writes every `every`th generation as an image into `dir` on its own thread.
+*
+*  The stepping thread only copies the grid into a free slot of the queue, encoding and
+*  I/O happen on the writer. When the writer falls behind the queue fills up and the
+*  stepping thread waits for a free slot, or drops the frame with `drop_when_full`.
+*/
+typedef struct {
+    const char *dir;
+    Frame_Format format;
+    uint64_t every;
+    bool drop_when_full;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    // The queued frames are `frames[(head + idx) % FRAME_QUEUE_SIZE]` for `idx < queued`.
+    Frame frames[FRAME_QUEUE_SIZE];
+    size_t head;
+    size_t queued;
+    bool quit;
+
+    // Only used by the writer.
+    char *path;
+    size_t path_size;
+    uint8_t *row;
+
+    uint64_t written_count;
+    uint64_t failed_count;
+    uint64_t dropped_count;
+    // How often and how long the stepping thread waited for a free slot.
+    uint64_t wait_count;
+    uint64_t wait_ns;
+    size_t max_queued;
+} Frame_Writer;
+
+// Mirrors the bits within every byte of `word`, the PBM format has the leftmost pixel in the highest bit.
+static inline uint64_t reverse_bits_in_bytes(uint64_t word) {
+    word = ((word >> 1) & UINT64_C(0x5555555555555555)) | ((word & UINT64_C(0x5555555555555555)) << 1);
+    word = ((word >> 2) & UINT64_C(0x3333333333333333)) | ((word & UINT64_C(0x3333333333333333)) << 2);
+    word = ((word >> 4) & UINT64_C(0x0F0F0F0F0F0F0F0F)) | ((word & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+    return word;
+}
+
+/**
+*   Writes `frame` as a binary PBM or PGM file named after its generation.
+*   Alive cells are black in both formats.
+*
+*   # Returns
+*
+*   If the whole file was written.
+*/
+static bool frame_writer_write_frame(Frame_Writer *writer, const Frame *frame) {
+    const char *extension = frame_format_to_string(writer->format);
+    snprintf(writer->path, writer->path_size, "%s/%010" PRIu64 ".%s", writer->dir, frame->generation, extension);
+    FILE *file = fopen(writer->path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    const bool is_bits = frame->bits.words != NULL;
+    const size_t rows = is_bits ? frame->bits.rows : frame->cells.rows;
+    const size_t cols = is_bits ? frame->bits.cols : frame->cells.cols;
+
+    switch (writer->format) {
+    case FRAME_FORMAT_PBM: {
+        fprintf(file, "P4\n%zu %zu\n", cols, rows);
+        const size_t row_size = (cols + 7) / 8;
+        for (size_t row = 0; row < rows; row++) {
+            if (is_bits) {
+                // The bytes of a little endian word are already in order. Bits past `cols`
+                // are 0, which is just the padding PBM wants.
+                const uint64_t *words = bit_array_row(frame->bits, row);
+                for (size_t idx = 0; idx < frame->bits.words_per_row; idx++) {
+                    const uint64_t word = reverse_bits_in_bytes(words[idx]);
+                    memcpy(&writer->row[idx * sizeof(uint64_t)], &word, sizeof(uint64_t));
+                }
+            } else {
+                const bool *cells = cell_array_row(frame->cells, row);
+                memset(writer->row, 0, row_size);
+                for (size_t col = 0; col < cols; col++) {
+                    writer->row[col / 8] |= cells[col] << (7 - col % 8);
+                }
+            }
+            fwrite(writer->row, 1, row_size, file);
+        }
+        break;
+    }
+
+    case FRAME_FORMAT_PGM: {
+        fprintf(file, "P5\n%zu %zu\n255\n", cols, rows);
+        for (size_t row = 0; row < rows; row++) {
+            if (is_bits) {
+                const uint64_t *words = bit_array_row(frame->bits, row);
+                for (size_t col = 0; col < cols; col++) {
+                    writer->row[col] = (words[col / BIT_ARRAY_WORD_BITS] >> (col % BIT_ARRAY_WORD_BITS)) & 1 ? 0 : 255;
+                }
+            } else {
+                const bool *cells = cell_array_row(frame->cells, row);
+                for (size_t col = 0; col < cols; col++) {
+                    writer->row[col] = cells[col] ? 0 : 255;
+                }
+            }
+            fwrite(writer->row, 1, cols, file);
+        }
+        break;
+    }
+    }
+
+    const bool failed = ferror(file) != 0;
+    return fclose(file) == 0 && !failed;
+}
+
+static void *frame_writer_thread(void *args) {
+    Frame_Writer *writer = args;
+
+    pthread_mutex_lock(&writer->lock);
+    while (true) {
+        while (writer->queued == 0 && !writer->quit) {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+        // Only quits once everything that was queued is written.
+        if (writer->queued == 0) {
+            break;
+        }
+
+        const Frame *frame = &writer->frames[writer->head];
+        pthread_mutex_unlock(&writer->lock);
+        const bool written = frame_writer_write_frame(writer, frame);
+        if (!written) {
+            PRINT_ERR("Failed writing frame \"%s\"!\n", writer->path);
+        }
+        pthread_mutex_lock(&writer->lock);
+
+        if (written) {
+            writer->written_count++;
+        } else {
+            writer->failed_count++;
+        }
+        writer->head = (writer->head + 1) % FRAME_QUEUE_SIZE;
+        writer->queued--;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+/**
+*   Creates `dir` if it does not exist yet, allocates the queue for frames of
+*   `rows` x `cols` cells and starts the writer thread. `bitpacked` frames copy the words of
+*   a bitpacked grid instead of cells. Exits when `dir` can not be created.
+*/
+void frame_writer_open(
+    Frame_Writer *writer,
+    const char *dir,
+    const Frame_Format format,
+    const uint64_t every,
+    const bool drop_when_full,
+    const size_t rows, const size_t cols,
+    const bool bitpacked
+) {
+    // Room for the generation and the extension.
+    const size_t path_size = strlen(dir) + 32;
+    *writer = (Frame_Writer){
+        .dir = dir,
+        .format = format,
+        .every = every,
+        .drop_when_full = drop_when_full,
+        .head = 0,
+        .queued = 0,
+        .quit = false,
+        .path = malloc(path_size),
+        .path_size = path_size,
+        // PBM rows of bitpacked frames are written a whole word at a time.
+        .row = malloc(cols + sizeof(uint64_t)),
+        .written_count = 0,
+        .failed_count = 0,
+        .dropped_count = 0,
+        .wait_count = 0,
+        .wait_ns = 0,
+        .max_queued = 0,
+    };
+    if (writer->path == NULL || writer->row == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the frame writer!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    struct stat dir_stat;
+    if (stat(dir, &dir_stat) != 0 && mkdir(dir, 0755) != 0) {
+        PRINT_ERR("Failed creating frame directory \"%s\"!\n", dir);
+        exit(EX_FRAME_DUMP_ERROR);
+    }
+    if (stat(dir, &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode)) {
+        PRINT_ERR("\"%s\" is not a directory to write frames to!\n", dir);
+        exit(EX_FRAME_DUMP_ERROR);
+    }
+
+    // All slots are allocated up front, queueing a frame is only a copy.
+    for (size_t idx = 0; idx < FRAME_QUEUE_SIZE; idx++) {
+        if (bitpacked) {
+            writer->frames[idx].bits = bit_array_init(rows, cols);
+        } else {
+            writer->frames[idx].cells = cell_array_init(rows, cols);
+        }
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    if (pthread_create(&writer->thread, NULL, frame_writer_thread, writer) != 0) {
+        PRINT_ERR("Failed creating the frame writer thread!\n");
+        exit(EX_THREAD_ERROR);
+    }
+}
+
+/**
+*   Waits for a free slot, or gives up on the frame with `drop_when_full`.
+*
+*   # Returns
+*
+*   The slot to copy the next frame into, which `frame_writer_push` then queues. NULL if the frame is dropped.
+*/
+static Frame *frame_writer_reserve(Frame_Writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    if (writer->queued == FRAME_QUEUE_SIZE) {
+        if (writer->drop_when_full) {
+            writer->dropped_count++;
+            pthread_mutex_unlock(&writer->lock);
+            return NULL;
+        }
+
+        const uint64_t wait_start_ns = monotonic_ns();
+        while (writer->queued == FRAME_QUEUE_SIZE) {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+        writer->wait_count++;
+        writer->wait_ns += monotonic_ns() - wait_start_ns;
+    }
+    // The writer never looks at slots past the queued ones.
+    Frame *frame = &writer->frames[(writer->head + writer->queued) % FRAME_QUEUE_SIZE];
+    pthread_mutex_unlock(&writer->lock);
+
+    return frame;
+}
+
+// Hands the frame from `frame_writer_reserve` to the writer.
+static void frame_writer_push(Frame_Writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->queued++;
+    writer->max_queued = MAX(writer->max_queued, writer->queued);
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// Waits until every queued frame is written.
+void frame_writer_drain(Frame_Writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    while (writer->queued > 0) {
+        pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+}
+
+// Writes the queued frames, stops the writer thread and frees the queue.
+void frame_writer_close(Frame_Writer *writer) {
+    pthread_mutex_lock(&writer->lock);
+    writer->quit = true;
+    pthread_cond_broadcast(&writer->changed);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+    for (size_t idx = 0; idx < FRAME_QUEUE_SIZE; idx++) {
+        bit_array_free_ptr(&writer->frames[idx].bits);
+        cell_array_free_ptr(&writer->frames[idx].cells);
+    }
+    free(writer->path);
+    free(writer->row);
+}
+
+/**
+*  A running simulation.
+*
+*  With `ENGINE_BOOL` `front` holds the current generation and `back` is where `step`
+*  writes the next one. Both are allocated once and swapped after every generation.
+*
+*  With `ENGINE_BITPACKED` the same goes for `bits_front` and `bits_back`. `front` is
+*  then only a view for rendering that is allocated and unpacked on demand by
+*  `simulation_grid`, so a simulation that is never rendered needs 1 bit per cell.
+*
+*  With `ENGINE_HASHLIFE` the cells live in `hashlife` and with `ENGINE_SPARSE` in `sparse`,
+*  `front` is a view like above. Both universes are unbounded, the grid is only the window
+*  that gets rendered.
+*/
+typedef struct {
+    Engine engine;
+    size_t rows;
+    size_t cols;
+
+    Cell_Array_2d front;
+    Cell_Array_2d back;
+
+    Bit_Array_2d bits_front;
+    Bit_Array_2d bits_back;
+    bool front_is_stale;
+
+    Hashlife *hashlife;
+    Sparse_Universe *sparse;
+
+    // The edges of the bool and bitpacked grids are neighbors like on a torus, otherwise
+    // everything outside of the grid is dead.
+    bool wrap;
+
+    // NULL when stepping on a single thread.
+    Worker_Pool *pool;
+
+    // Active tile tracking, NULL when disabled. See `step_tiles_band`.
+    bool *tiles_changed;
+    bool *tiles_changed_next;
+    size_t tile_rows;
+    size_t tile_cols;
+    // Active tiles of the last generation per worker, summed up in `active_tile_count`.
+    size_t *worker_active_tile_counts;
+    size_t active_tile_count;
+
+    uint64_t generation;
+
+    // NULL unless `simulation_detect_cycles` was called.
+    Cycle_Detector *cycles;
+    // NULL unless `simulation_write_metrics` was called.
+    Metrics *metrics;
+    // NULL unless `simulation_dump_frames` was called.
+    Frame_Writer *frames;
+
+    // Saves a snapshot to `checkpoint_path` every `checkpoint_every` generations when both are set.
+    const char *checkpoint_path;
+    uint64_t checkpoint_every;
+    // The snapshot `bits_front` or `bits_back` points into after resuming, NULL otherwise.
+    void *snapshot_mapping;
+    size_t snapshot_mapping_size;
+} Simulation;
+
+// Tiles are TILE_SIZE x TILE_SIZE cells, for the bitpacked engine that is 1 word wide.
+#define TILE_SIZE BIT_ARRAY_WORD_BITS
+
+Simulation simulation_init(
+    const size_t rows, const size_t cols,
+    const Engine engine,
+    const size_t thread_count,
+    const bool active_tiles,
+    const bool wrap
+) {
+    // Hashlife steps the whole tree at once so threads do not apply to it.
+    // Tiles only make sense for the fixed grids.
+    const bool use_pool = engine != ENGINE_HASHLIFE && thread_count > 1;
+    const bool is_grid_engine = engine == ENGINE_BOOL || engine == ENGINE_BITPACKED;
+
+    Simulation simulation = {
+        .engine = engine,
+        .rows = rows,
+        .cols = cols,
+        .front_is_stale = false,
+        .hashlife = NULL,
+        .sparse = NULL,
+        .wrap = wrap,
+        .pool = use_pool ? worker_pool_init(thread_count) : NULL,
+        .tiles_changed = NULL,
+        .tiles_changed_next = NULL,
+        .tile_rows = (rows + TILE_SIZE - 1) / TILE_SIZE,
+        .tile_cols = (cols + TILE_SIZE - 1) / TILE_SIZE,
+        .worker_active_tile_counts = NULL,
+        .active_tile_count = 0,
+        .generation = 0,
+        .cycles = NULL,
+        .metrics = NULL,
+        .frames = NULL,
+        .checkpoint_path = NULL,
+        .checkpoint_every = 0,
+        .snapshot_mapping = NULL,
+        .snapshot_mapping_size = 0,
+    };
+
+    if (is_grid_engine && active_tiles) {
+        const size_t tile_count = simulation.tile_rows * simulation.tile_cols;
+        simulation.tiles_changed = malloc(sizeof(bool) * tile_count);
+        simulation.tiles_changed_next = malloc(sizeof(bool) * tile_count);
+        simulation.worker_active_tile_counts = calloc(MAX(thread_count, 1), sizeof(size_t));
+        if (simulation.tiles_changed == NULL
+            || simulation.tiles_changed_next == NULL
+            || simulation.worker_active_tile_counts == NULL
+        ) {
+            PRINT_ERR_LOC("Failed allocating memory for the active tiles!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+
+        // `back` does not match `front` yet, so everything has to be computed once.
+        memset(simulation.tiles_changed, true, sizeof(bool) * tile_count);
+        memset(simulation.tiles_changed_next, false, sizeof(bool) * tile_count);
+        simulation.active_tile_count = tile_count;
+    }
+
+    switch (engine) {
+    case ENGINE_BOOL: {
+        simulation.front = cell_array_init(rows, cols);
+        simulation.back = cell_array_init(rows, cols);
+        break;
+    }
+
+    case ENGINE_BITPACKED: {
+        simulation.bits_front = bit_array_init(rows, cols);
+        simulation.bits_back = bit_array_init(rows, cols);
+        break;
+    }
+
+    case ENGINE_HASHLIFE: {
+        // Smallest level whose square covers the grid, with room to look at a 4x4 node.
+        uint8_t level = 3;
+        while ((UINT64_C(1) << level) < MAX(rows, cols)) {
+            level++;
+        }
+        simulation.hashlife = hashlife_init(level);
+        break;
+    }
+
+    case ENGINE_SPARSE: {
+        simulation.sparse = sparse_init();
+        break;
+    }
+    }
+
+    return simulation;
+}
+
+void simulation_free(Simulation *simulation) {
+    if (simulation->pool != NULL) {
+        worker_pool_free(simulation->pool);
+        simulation->pool = NULL;
+    }
+    free(simulation->tiles_changed);
+    free(simulation->tiles_changed_next);
+    free(simulation->worker_active_tile_counts);
+    simulation->tiles_changed = NULL;
+    simulation->tiles_changed_next = NULL;
+    simulation->worker_active_tile_counts = NULL;
+
+    if (simulation->hashlife != NULL) {
+        hashlife_free(simulation->hashlife);
+        simulation->hashlife = NULL;
+    }
+    if (simulation->sparse != NULL) {
+        sparse_free(simulation->sparse);
+        simulation->sparse = NULL;
+    }
+    if (simulation->cycles != NULL) {
+        free(simulation->cycles->worker_hash_deltas);
+        free(simulation->cycles);
+        simulation->cycles = NULL;
+    }
+    if (simulation->metrics != NULL) {
+        metrics_writer_close(&simulation->metrics->writer);
+        free(simulation->metrics->worker_counts);
+        free(simulation->metrics->tile_boxes);
+        free(simulation->metrics);
+        simulation->metrics = NULL;
+    }
+    if (simulation->frames != NULL) {
+        frame_writer_close(simulation->frames);
+        free(simulation->frames);
+        simulation->frames = NULL;
+    }
+
+    if (simulation->snapshot_mapping != NULL) {
+        // The words of the mapped snapshot are not from `bit_array_init`, so they are unmapped instead.
+        const uint64_t *mapped_words = (const uint64_t *)((const char *)simulation->snapshot_mapping + CELL_ARRAY_ALIGNMENT);
+        if (simulation->bits_front.words == mapped_words) {
+            simulation->bits_front.words = NULL;
+        }
+        if (simulation->bits_back.words == mapped_words) {
+            simulation->bits_back.words = NULL;
+        }
+        munmap(simulation->snapshot_mapping, simulation->snapshot_mapping_size);
+        simulation->snapshot_mapping = NULL;
+    }
+
+    // Freeing arrays that were never allocated is fine, their pointers are NULL.
+    cell_array_free_ptr(&simulation->front);
+    cell_array_free_ptr(&simulation->back);
+    bit_array_free_ptr(&simulation->bits_front);
+    bit_array_free_ptr(&simulation->bits_back);
+}
+
+/**
+*   # Returns
+*
+*   The current generation as a Cell Array for rendering.
+*/
+Cell_Array_2d simulation_grid(Simulation *simulation) {
+    if (simulation->engine == ENGINE_BOOL) {
+        return simulation->front;
+    }
+
+    if (simulation->front.cells == NULL) {
+        simulation->front = cell_array_init(simulation->rows, simulation->cols);
+        simulation->front_is_stale = true;
+    }
+    if (simulation->front_is_stale) {
+        switch (simulation->engine) {
+            case ENGINE_BOOL:      break;
+            case ENGINE_BITPACKED: bit_array_unpack(&simulation->front, simulation->bits_front); break;
+            case ENGINE_HASHLIFE:  hashlife_write_cells(simulation->hashlife, &simulation->front); break;
+            case ENGINE_SPARSE:    sparse_write_cells(simulation->sparse, &simulation->front); break;
+        }
+        simulation->front_is_stale = false;
+    }
+
+    return simulation->front;
+}
+
+void simulation_set(Simulation *simulation, const size_t row, const size_t col, const bool value) {
+    switch (simulation->engine) {
+    case ENGINE_BOOL: {
+        cell_array_set(&simulation->front, row, col, value);
+        break;
+    }
+
+    case ENGINE_BITPACKED:
+    case ENGINE_HASHLIFE:
+    case ENGINE_SPARSE: {
+        if (simulation->engine == ENGINE_BITPACKED) {
+            bit_array_set(&simulation->bits_front, row, col, value);
+        } else {
+            if (row >= simulation->rows || col >= simulation->cols) {
+                PRINT_ERR_LOC("Cell index out of range! (%zu, %zu) is outside of the grid.\n", row, col);
+                exit(EX_ARR_OUT_OF_RANGE);
+            }
+
+            if (simulation->engine == ENGINE_HASHLIFE) {
+                hashlife_set(simulation->hashlife, row, col, value);
+            } else {
+                sparse_set(simulation->sparse, row, col, value);
+            }
+        }
+
+        // Keep an up to date view in sync instead of unpacking everything again.
+        if (simulation->front.cells != NULL && !simulation->front_is_stale) {
+            cell_array_set(&simulation->front, row, col, value);
+        }
+        break;
+    }
+    }
+
+    // The tile of an edited cell no longer matches `back`.
+    if (simulation->tiles_changed != NULL) {
+        simulation->tiles_changed[(row / TILE_SIZE) * simulation->tile_cols + col / TILE_SIZE] = true;
+    }
+    if (simulation->cycles != NULL) {
+        simulation->cycles->hash_is_stale = true;
+    }
+    if (simulation->metrics != NULL) {
+        simulation->metrics->is_stale = true;
+    }
+}
+
+uint64_t simulation_population(const Simulation *simulation) {
+    uint64_t population = 0;
+    switch (simulation->engine) {
+    case ENGINE_BOOL: {
+        for (size_t row = 0; row < simulation->rows; row++) {
+            const bool *cells = cell_array_row(simulation->front, row);
+            for (size_t col = 0; col < simulation->cols; col++) {
+                population += cells[col];
+            }
+        }
+        break;
+    }
+
+    case ENGINE_BITPACKED: {
+        const size_t word_count = simulation->rows * simulation->bits_front.words_per_row;
+        for (size_t idx = 0; idx < word_count; idx++) {
+            population += __builtin_popcountll(simulation->bits_front.words[idx]);
+        }
+        break;
+    }
+
+    case ENGINE_HASHLIFE: population = simulation->hashlife->root->population; break;
+    case ENGINE_SPARSE:   population = simulation->sparse->population; break;
+    }
+
+    return population;
+}
+
+#if ENABLE_STATS
+
+/**
+*   Prints the latency of every phase that ran, the allocations per generation and the
+*   population to stderr. Has to run on the thread that steps `simulation`.
+*/
+void stats_report(Simulation *simulation) {
+    atomic_store(&stats.report_requested, false);
+
+    const uint64_t generations = atomic_load_explicit(&stats.generations, memory_order_relaxed);
+    const uint64_t allocations = atomic_load_explicit(&stats.allocations, memory_order_relaxed);
+    const uint64_t max_allocations = atomic_load_explicit(&stats.max_allocations_per_generation, memory_order_relaxed);
+    const double allocations_per_generation = generations > 0 ? (double)allocations / generations : 0;
+    const uint64_t population = simulation_population(simulation);
+
+    // CPU time of all threads against wall time, shows how much an idle frontend burns.
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    const double wall_seconds = (monotonic_ns() - stats.start_ns) / 1e9;
+
+    switch (stats.format) {
+    case STATS_FORMAT_TABLE: {
+        fprintf(stderr, "%-12s %10s %12s %12s %12s %12s\n", "phase", "count", "p50 us", "p99 us", "max us", "mean us");
+        for (Stats_Phase phase = STATS_PHASE_STEP; phase < STATS_PHASE_COUNT; phase++) {
+            const Stats_Histogram *histogram = &stats.phases[phase];
+            const uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            fprintf(
+                stderr, "%-12s %10" PRIu64 " %12.3f %12.3f %12.3f %12.3f\n",
+                stats_phase_to_string(phase),
+                count,
+                stats_percentile(histogram, 0.5) / 1e3,
+                stats_percentile(histogram, 0.99) / 1e3,
+                atomic_load_explicit(&histogram->max_ns, memory_order_relaxed) / 1e3,
+                atomic_load_explicit(&histogram->total_ns, memory_order_relaxed) / 1e3 / count
+            );
+        }
+        fprintf(stderr, "generations:                %" PRIu64 "\n", generations);
+        fprintf(stderr, "allocations/generation:     %.3f (max %" PRIu64 ")\n", allocations_per_generation, max_allocations);
+        fprintf(stderr, "population:                 %" PRIu64 "\n", population);
+        fprintf(
+            stderr, "cpu:                        %.3f s in %.3f s (%.1f%%)\n",
+            cpu_seconds, wall_seconds, wall_seconds > 0 ? cpu_seconds / wall_seconds * 100 : 0
+        );
+        break;
+    }
+
+    case STATS_FORMAT_JSON: {
+        fprintf(stderr, "{\"phases\":{");
+        bool first = true;
+        for (Stats_Phase phase = STATS_PHASE_STEP; phase < STATS_PHASE_COUNT; phase++) {
+            const Stats_Histogram *histogram = &stats.phases[phase];
+            const uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            fprintf(
+                stderr,
+                "%s\"%s\":{\"count\":%" PRIu64 ",\"p50_ns\":%" PRIu64 ",\"p99_ns\":%" PRIu64 ",\"max_ns\":%" PRIu64 ",\"total_ns\":%" PRIu64 "}",
+                first ? "" : ",",
+                stats_phase_to_string(phase),
+                count,
+                stats_percentile(histogram, 0.5),
+                stats_percentile(histogram, 0.99),
+                atomic_load_explicit(&histogram->max_ns, memory_order_relaxed),
+                atomic_load_explicit(&histogram->total_ns, memory_order_relaxed)
+            );
+            first = false;
+        }
+        fprintf(
+            stderr,
+            "},\"generations\":%" PRIu64 ",\"allocations\":%" PRIu64 ",\"allocations_per_generation\":%.3f"
+            ",\"max_allocations_per_generation\":%" PRIu64 ",\"population\":%" PRIu64
+            ",\"cpu_seconds\":%.6f,\"wall_seconds\":%.6f}\n",
+            generations, allocations, allocations_per_generation, max_allocations, population,
+            cpu_seconds, wall_seconds
+        );
+        break;
+    }
+    }
+}
+
+// Prints the report when SIGUSR1 asked for one.
+static inline void stats_poll_report(Simulation *simulation) {
+    if (stats.enabled && atomic_load_explicit(&stats.report_requested, memory_order_relaxed)) {
+        stats_report(simulation);
+    }
+}
+
+#else
+
+static inline void stats_record_generations(const uint64_t generations, const uint64_t allocations) {
+    UNUSED(generations);
+    UNUSED(allocations);
+}
+
+static inline void stats_poll_report(Simulation *simulation) {
+    UNUSED(simulation);
+}
+
+#endif // ENABLE_STATS
+
+/**
+*  A pattern of alive cells given as (row, col) pairs, with (0, 0) at its top left.
+*/
+typedef struct {
+    const char *name;
+    const uint16_t (*cells)[2];
+    size_t cell_count;
+} Pattern;
+
+// Gosper's glider gun, needs 12 rows by 38 columns.
+static const uint16_t GLIDER_GUN_CELLS[][2] = {
+    {5, 1}, {5, 2}, {6, 1}, {6, 2},
+
+    {3, 13}, {3, 14}, {4, 12}, {4, 16}, {5, 11}, {5, 17}, {6, 11}, {6, 15},
+    {6, 17}, {6, 18}, {7, 17}, {7, 11}, {8, 12}, {8, 16}, {9, 13}, {9, 14},
+
+    {1, 25}, {2, 23}, {2, 25}, {3, 21}, {3, 22}, {4, 21}, {4, 22}, {5, 21},
+    {5, 22}, {6, 23}, {6, 25}, {7, 25},
+
+    {3, 35}, {3, 36}, {4, 35}, {4, 36},
+};
+
+static const uint16_t R_PENTOMINO_CELLS[][2] = {
+    {0, 1}, {0, 2},
+    {1, 0}, {1, 1},
+    {2, 1},
+};
+
+static const uint16_t ACORN_CELLS[][2] = {
+    {0, 1},
+    {1, 3},
+    {2, 0}, {2, 1}, {2, 4}, {2, 5}, {2, 6},
+};
+
+typedef enum {
+    PATTERN_GLIDER_GUN  = 0,
+    PATTERN_R_PENTOMINO = 1,
+    PATTERN_ACORN       = 2,
+} Pattern_Id;
+#define PATTERN_COUNT ((PATTERN_ACORN - PATTERN_GLIDER_GUN) + 1)
+
+static const Pattern PATTERNS[PATTERN_COUNT] = {
+    [PATTERN_GLIDER_GUN]  = { "glider-gun",  GLIDER_GUN_CELLS,  ARR_LEN(GLIDER_GUN_CELLS)  },
+    [PATTERN_R_PENTOMINO] = { "r-pentomino", R_PENTOMINO_CELLS, ARR_LEN(R_PENTOMINO_CELLS) },
+    [PATTERN_ACORN]       = { "acorn",       ACORN_CELLS,       ARR_LEN(ACORN_CELLS)       },
+};
+
+void simulation_place_pattern(Simulation *simulation, const Pattern *pattern, const size_t row, const size_t col) {
+    for (size_t idx = 0; idx < pattern->cell_count; idx++) {
+        simulation_set(simulation, row + pattern->cells[idx][0], col + pattern->cells[idx][1], true);
+    }
+}
+
+static inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+    return x ^ (x >> 31);
+}
+
+/**
+*   # Returns
+*
+*   If the cell is alive in the soup of the given seed. Every cell is hashed on its own,
+*   so the soup is the same no matter how many threads fill it.
+*/
+static inline bool soup_cell(const uint64_t seed, const uint64_t threshold, const size_t row, const size_t col) {
+    return splitmix64(seed ^ splitmix64(((uint64_t)row << 32) ^ col)) < threshold;
+}
+
+typedef struct {
+    Simulation *simulation;
+    uint64_t seed;
+    uint64_t threshold;
+} Soup_Fill;
+
+void fill_soup_band(void *data, const size_t worker_idx, const size_t worker_count) {
+    const Soup_Fill *fill = data;
+    Simulation *simulation = fill->simulation;
+    const size_t row_begin = simulation->rows * worker_idx / worker_count;
+    const size_t row_end = simulation->rows * (worker_idx + 1) / worker_count;
+
+    for (size_t row = row_begin; row < row_end; row++) {
+        switch (simulation->engine) {
+        case ENGINE_BOOL: {
+            bool *cells = cell_array_row(simulation->front, row);
+            for (size_t col = 0; col < simulation->cols; col++) {
+                cells[col] = soup_cell(fill->seed, fill->threshold, row, col);
+            }
+            break;
+        }
+
+        case ENGINE_BITPACKED: {
+            uint64_t *words = bit_array_row(simulation->bits_front, row);
+            for (size_t word_idx = 0; word_idx < simulation->bits_front.words_per_row; word_idx++) {
+                const size_t col_start = word_idx * BIT_ARRAY_WORD_BITS;
+                const size_t col_end = MIN(col_start + BIT_ARRAY_WORD_BITS, simulation->cols);
+
+                uint64_t word = 0;
+                for (size_t col = col_start; col < col_end; col++) {
+                    word |= (uint64_t)soup_cell(fill->seed, fill->threshold, row, col) << (col - col_start);
+                }
+                words[word_idx] = word;
+            }
+            break;
+        }
+
+        case ENGINE_HASHLIFE: break;
+        case ENGINE_SPARSE:   break;
+        }
+    }
+}
+
+/**
+*   Replaces the grid with a random soup where each cell is alive with probability `density`.
+*/
+void simulation_fill_soup(Simulation *simulation, const uint64_t seed, const double density) {
+    const uint64_t threshold = density >= 1.0 ? UINT64_MAX : (uint64_t)(density * 18446744073709551616.0);
+
+    switch (simulation->engine) {
+    case ENGINE_BOOL:
+    case ENGINE_BITPACKED: {
+        Soup_Fill fill = { .simulation = simulation, .seed = seed, .threshold = threshold };
+        if (simulation->pool != NULL) {
+            worker_pool_run(simulation->pool, fill_soup_band, &fill);
+        } else {
+            fill_soup_band(&fill, 0, 1);
+        }
+
+        simulation->front_is_stale = simulation->engine == ENGINE_BITPACKED;
+        if (simulation->tiles_changed != NULL) {
+            memset(simulation->tiles_changed, true, simulation->tile_rows * simulation->tile_cols);
+        }
+        if (simulation->cycles != NULL) {
+            simulation->cycles->hash_is_stale = true;
+        }
+        if (simulation->metrics != NULL) {
+            simulation->metrics->is_stale = true;
+        }
+        break;
+    }
+
+    // The unbounded engines have no flat buffer to fill, so only the alive cells are set.
+    case ENGINE_HASHLIFE:
+    case ENGINE_SPARSE: {
+        for (size_t row = 0; row < simulation->rows; row++) {
+            for (size_t col = 0; col < simulation->cols; col++) {
+                if (soup_cell(seed, threshold, row, col)) {
+                    simulation_set(simulation, row, col, true);
+                }
+            }
+        }
+        break;
+    }
+    }
+}
+
+/**
+*   Sets the `length` cells starting at (`row`, `col`) alive. The bounded grids clip the run
+*   to the grid, the unbounded universes take it as it is.
+*   Whole runs are written at once instead of going through `simulation_set` for every cell.
+*
+*   # Returns
+*
+*   How many of the cells were set, so inside the grid for the bounded ones.
+*/
+uint64_t simulation_set_alive_run(Simulation *simulation, const int64_t row, const int64_t col, const uint64_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    // Saturate so giant runs far to the right do not wrap around.
+    const int64_t run_end = length > (uint64_t)(INT64_MAX - col) ? INT64_MAX : col + (int64_t)length;
+
+    uint64_t placed = 0;
+    switch (simulation->engine) {
+    case ENGINE_BOOL:
+    case ENGINE_BITPACKED: {
+        if (row < 0 || (uint64_t)row >= simulation->rows) {
+            return 0;
+        }
+        const uint64_t col_begin = MAX(col, 0);
+        if (run_end <= 0 || col_begin >= simulation->cols) {
+            return 0;
+        }
+        const uint64_t col_end = MIN((uint64_t)run_end, simulation->cols);
+
+        if (simulation->engine == ENGINE_BOOL) {
+            memset(&cell_array_row(simulation->front, row)[col_begin], true, col_end - col_begin);
+        } else {
+            uint64_t *words = bit_array_row(simulation->bits_front, row);
+            for (uint64_t word_idx = col_begin / BIT_ARRAY_WORD_BITS; word_idx <= (col_end - 1) / BIT_ARRAY_WORD_BITS; word_idx++) {
+                const uint64_t word_col = word_idx * BIT_ARRAY_WORD_BITS;
+                const uint64_t bit_begin = MAX(col_begin, word_col) - word_col;
+                const uint64_t bit_end = MIN(col_end, word_col + BIT_ARRAY_WORD_BITS) - word_col;
+                const uint64_t high_mask = bit_end == BIT_ARRAY_WORD_BITS ? UINT64_MAX : (UINT64_C(1) << bit_end) - 1;
+                words[word_idx] |= high_mask & ~((UINT64_C(1) << bit_begin) - 1);
+            }
+            simulation->front_is_stale = true;
+        }
+
+        if (simulation->tiles_changed != NULL) {
+            bool *tiles_changed = &simulation->tiles_changed[(row / TILE_SIZE) * simulation->tile_cols];
+            for (uint64_t tile_col = col_begin / TILE_SIZE; tile_col <= (col_end - 1) / TILE_SIZE; tile_col++) {
+                tiles_changed[tile_col] = true;
+            }
+        }
+        placed = col_end - col_begin;
+        break;
+    }
+
+    // The grid is only the window that gets rendered, patterns can be anywhere.
+    case ENGINE_HASHLIFE: {
+        for (int64_t cell_col = col; cell_col < run_end; cell_col++) {
+            hashlife_set(simulation->hashlife, row, cell_col, true);
+        }
+        simulation->front_is_stale = true;
+        placed = (uint64_t)run_end - (uint64_t)col;
+        break;
+    }
+
+    case ENGINE_SPARSE: {
+        sparse_set_alive_run(simulation->sparse, row, col, run_end);
+        simulation->front_is_stale = true;
+        placed = (uint64_t)run_end - (uint64_t)col;
+        break;
+    }
+    }
+
+    if (simulation->cycles != NULL) {
+        simulation->cycles->hash_is_stale = true;
+    }
+    if (simulation->metrics != NULL) {
+        simulation->metrics->is_stale = true;
+    }
+
+    return placed;
+}
+
+typedef enum {
+    PATTERN_FORMAT_RLE   = 0,
+    PATTERN_FORMAT_CELLS = 1,
+} Pattern_Format;
+
+/**
+*  Reads a pattern file one character at a time, so files of any size are never fully in memory.
+*/
+typedef struct {
+    FILE *file;
+    const char *path;
+    size_t line;
+} Pattern_Reader;
+
+static inline int pattern_reader_next(Pattern_Reader *reader) {
+    const int c = getc_unlocked(reader->file);
+    if (c == '\n') {
+        reader->line++;
+    }
+    return c;
+}
+
+static void pattern_reader_skip_line(Pattern_Reader *reader) {
+    int c = 0;
+    while ((c = pattern_reader_next(reader)) != EOF && c != '\n');
+}
+
+#define PATTERN_PARSE_ERROR(reader, fmt, ...)                                           \
+    do {                                                                                \
+        PRINT_ERR("%s:%zu: " fmt, (reader)->path, (reader)->line __VA_OPT__(,) __VA_ARGS__); \
+        exit(EX_PATTERN_PARSE_ERROR);                                                   \
+    } while (0)
+
+/**
+*   Parses a run length encoded pattern, see https://conwaylife.com/wiki/Run_Length_Encoded
+*
+*   # Returns
+*
+*   The number of alive cells that were placed, see `simulation_set_alive_run`.
+*/
+static uint64_t pattern_load_rle(Pattern_Reader *reader, Simulation *simulation, const int64_t row_offset, const int64_t col_offset) {
+    uint64_t placed = 0;
+    int64_t row = 0;
+    int64_t col = 0;
+    uint64_t count = 0;
+    bool has_count = false;
+    bool at_line_start = true;
+    bool in_body = false;
+
+    int c = 0;
+    while ((c = pattern_reader_next(reader)) != EOF) {
+        if (at_line_start && c == '#') {
+            pattern_reader_skip_line(reader);
+            continue;
+        }
+        // The header, like "x = 3, y = 3, rule = B3/S23". The size is not needed for streaming.
+        if (at_line_start && !in_body && c == 'x') {
+            pattern_reader_skip_line(reader);
+            continue;
+        }
+        at_line_start = c == '\n';
+
+        if (c >= '0' && c <= '9') {
+            if (count > (UINT64_MAX - 9) / 10) {
+                PATTERN_PARSE_ERROR(reader, "Run count is too big!\n");
+            }
+            count = count * 10 + (c - '0');
+            has_count = true;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            if (has_count) {
+                PATTERN_PARSE_ERROR(reader, "Run count without a cell state!\n");
+            }
+            continue;
+        }
+
+        in_body = true;
+        const uint64_t run = has_count ? count : 1;
+        count = 0;
+        has_count = false;
+
+        if (c == 'b' || c == '.') {
+            col += run;
+        } else
+        if (c == '$') {
+            row += run;
+            col = 0;
+        } else
+        if (c == '!') {
+            break;
+        } else
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            // 'o', or one of the states of multi state rules which all count as alive.
+            placed += simulation_set_alive_run(simulation, row_offset + row, col_offset + col, run);
+            col += run;
+        } else {
+            PATTERN_PARSE_ERROR(reader, "Invalid character '%c' in RLE pattern!\n", c);
+        }
+    }
+
+    return placed;
+}
+
+/**
+*   Parses a plaintext pattern, see https://conwaylife.com/wiki/Plaintext
+*
+*   # Returns
+*
+*   The number of alive cells that were placed, see `simulation_set_alive_run`.
+*/
+static uint64_t pattern_load_cells(Pattern_Reader *reader, Simulation *simulation, const int64_t row_offset, const int64_t col_offset) {
+    uint64_t placed = 0;
+    int64_t row = 0;
+    int64_t col = 0;
+    // Alive cells are collected into runs that are written at once.
+    uint64_t run = 0;
+    bool at_line_start = true;
+
+    #define FLUSH_RUN()                                                                                  \
+        if (run > 0) {                                                                                   \
+            placed += simulation_set_alive_run(simulation, row_offset + row, col_offset + col - run, run); \
+            run = 0;                                                                                     \
+        }
+
+    int c = 0;
+    while ((c = pattern_reader_next(reader)) != EOF) {
+        if (at_line_start && c == '!') {
+            pattern_reader_skip_line(reader);
+            continue;
+        }
+        at_line_start = c == '\n';
+
+        switch (c) {
+        case 'O':
+        case '*': {
+            run++;
+            col++;
+            break;
+        }
+
+        case '.': {
+            FLUSH_RUN();
+            col++;
+            break;
+        }
+
+        case '\n': {
+            FLUSH_RUN();
+            row++;
+            col = 0;
+            break;
+        }
+
+        case '\r':
+        case ' ':
+        case '\t': break;
+
+        default: {
+            PATTERN_PARSE_ERROR(reader, "Invalid character '%c' in plaintext pattern!\n", c);
+        }
+        }
+    }
+    FLUSH_RUN();
+
+    #undef FLUSH_RUN
+
+    return placed;
+}
+
+/**
+*   Loads an RLE (.rle) or plaintext (.cells) pattern file with its top left at
+*   (`row_offset`, `col_offset`). The bounded grids drop cells outside of them with a warning,
+*   the unbounded universes keep every cell.
+*/
+void simulation_load_pattern_file(Simulation *simulation, const char *path, const int64_t row_offset, const int64_t col_offset) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        PRINT_ERR("Failed opening pattern file \"%s\"!\n", path);
+        exit(EX_INPUT_READ_ERROR);
+    }
+    Pattern_Reader reader = { .file = file, .path = path, .line = 1 };
+
+    Pattern_Format format = PATTERN_FORMAT_RLE;
+    const char *extension = strrchr(path, '.');
+    if (extension != NULL && strcmp(extension, ".cells") == 0) {
+        format = PATTERN_FORMAT_CELLS;
+    } else
+    if (extension == NULL || strcmp(extension, ".rle") != 0) {
+        // Unknown extension, plaintext files start with a "!Name:" comment.
+        const int first = getc(file);
+        format = first == '!' ? PATTERN_FORMAT_CELLS : PATTERN_FORMAT_RLE;
+        ungetc(first, file);
+    }
+
+    uint64_t placed = 0;
+    switch (format) {
+        case PATTERN_FORMAT_RLE:   placed = pattern_load_rle(&reader, simulation, row_offset, col_offset); break;
+        case PATTERN_FORMAT_CELLS: placed = pattern_load_cells(&reader, simulation, row_offset, col_offset); break;
+    }
+
+    if (ferror(file)) {
+        PRINT_ERR("Failed reading pattern file \"%s\"!\n", path);
+        fclose(file);
+        exit(EX_INPUT_READ_ERROR);
+    }
+    fclose(file);
+
+    if (placed == 0 && (simulation->engine == ENGINE_HASHLIFE || simulation->engine == ENGINE_SPARSE)) {
+        PRINT_WARN("The pattern \"%s\" has no alive cells.\n", path);
+    } else
+    if (placed == 0) {
+        PRINT_WARN("No cells of the pattern \"%s\" are inside the grid.\n", path);
+    }
+}
+
+/**
+*   The start of a snapshot file. It is followed by `rows * words_per_row` words that hold
+*   the cells bit packed like a `Bit_Array_2d`, in the byte order of the machine that wrote it.
+*   The header is one cache line so the words of a mapped file are aligned like `bit_array_init` ones.
+*/
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t generation;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t words_per_row;
+    // The rule, like `Rule`.
+    uint16_t birth;
+    uint16_t survival;
+    uint8_t reserved[12];
+} Snapshot_Header;
+_Static_assert(sizeof(Snapshot_Header) == CELL_ARRAY_ALIGNMENT, "Snapshot header should be one cache line");
+
+#define SNAPSHOT_MAGIC "CGOLSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER UINT32_C(0x01020304)
+
+/**
+*   A snapshot file mapped into memory, see `snapshot_open`.
+*/
+typedef struct {
+    void *mapping;
+    size_t size;
+    const Snapshot_Header *header;
+    uint64_t *words;
+} Snapshot;
+
+/**
+*   Writes the current generation to `path`. The file is written next to it first and then
+*   renamed over it, so a crash while saving never leaves a broken snapshot behind.
+*   Only for the bool and bitpacked engines, a snapshot has no room for an unbounded universe.
+*
+*   # Returns
+*
+*   If the snapshot was written.
+*/
+bool simulation_save_snapshot(Simulation *simulation, const char *path) {
+    const size_t words_per_row = (simulation->cols + BIT_ARRAY_WORD_BITS - 1) / BIT_ARRAY_WORD_BITS;
+    Snapshot_Header header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .byte_order = SNAPSHOT_BYTE_ORDER,
+        .generation = simulation->generation,
+        .rows = simulation->rows,
+        .cols = simulation->cols,
+        .words_per_row = words_per_row,
+        .birth = life_rule.birth,
+        .survival = life_rule.survival,
+    };
+
+    const size_t temp_path_size = strlen(path) + sizeof(".tmp");
+    char *temp_path = malloc(temp_path_size);
+    if (temp_path == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the snapshot path!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    snprintf(temp_path, temp_path_size, "%s.tmp", path);
+
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        PRINT_ERR("Failed opening snapshot file \"%s\"!\n", temp_path);
+        free(temp_path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (simulation->engine == ENGINE_BITPACKED) {
+        // Same layout as in memory, so it is one write.
+        const size_t word_count = simulation->rows * words_per_row;
+        ok = ok && fwrite(simulation->bits_front.words, sizeof(uint64_t), word_count, file) == word_count;
+    } else {
+        const Cell_Array_2d grid = simulation_grid(simulation);
+        uint64_t *row_words = malloc(sizeof(uint64_t) * MAX(words_per_row, 1));
+        if (row_words == NULL) {
+            PRINT_ERR_LOC("Failed allocating memory for a snapshot row!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+
+        for (size_t row = 0; row < grid.rows && ok; row++) {
+            const bool *cells = cell_array_row(grid, row);
+            memset(row_words, 0, sizeof(uint64_t) * words_per_row);
+            for (size_t col = 0; col < grid.cols; col++) {
+                row_words[col / BIT_ARRAY_WORD_BITS] |= (uint64_t)cells[col] << (col % BIT_ARRAY_WORD_BITS);
+            }
+            ok = fwrite(row_words, sizeof(uint64_t), words_per_row, file) == words_per_row;
+        }
+        free(row_words);
+    }
+
+    // Pad to whole cache lines, the step kernels may read the rest of the last one.
+    const uint8_t padding[CELL_ARRAY_ALIGNMENT] = {0};
+    const size_t data_size = simulation->rows * words_per_row * sizeof(uint64_t);
+    const size_t padding_size = (CELL_ARRAY_ALIGNMENT - data_size % CELL_ARRAY_ALIGNMENT) % CELL_ARRAY_ALIGNMENT;
+    ok = ok && fwrite(padding, 1, padding_size, file) == padding_size;
+
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temp_path, path) == 0;
+    if (!ok) {
+        PRINT_ERR("Failed writing snapshot file \"%s\"!\n", path);
+        remove(temp_path);
+    }
+
+    free(temp_path);
+    return ok;
+}
+
+/**
+*   Maps the snapshot at `path` into memory and checks its header.
+*   The mapping is private, writing to it never changes the file.
+*/
+Snapshot snapshot_open(const char *path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        PRINT_ERR("Failed opening snapshot file \"%s\"!\n", path);
+        exit(EX_INPUT_READ_ERROR);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        PRINT_ERR("Failed reading snapshot file \"%s\"!\n", path);
+        close(fd);
+        exit(EX_INPUT_READ_ERROR);
+    }
+    if ((size_t)file_stat.st_size < sizeof(Snapshot_Header)) {
+        PRINT_ERR("\"%s\" is too small to be a snapshot!\n", path);
+        close(fd);
+        exit(EX_SNAPSHOT_ERROR);
+    }
+
+    const size_t size = file_stat.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the file.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        PRINT_ERR("Failed mapping snapshot file \"%s\"!\n", path);
+        exit(EX_INPUT_READ_ERROR);
+    }
+
+    const Snapshot_Header *header = mapping;
+    const char *error = NULL;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        error = "is not a snapshot";
+    } else
+    if (header->version != SNAPSHOT_VERSION) {
+        error = "has an unsupported version";
+    } else
+    if (header->byte_order != SNAPSHOT_BYTE_ORDER) {
+        error = "was written on a machine with a different byte order";
+    } else
+    if ((header->birth | header->survival) >= RULE_BIT(9)) {
+        error = "has an invalid rule";
+    } else
+    if (header->rows == 0 || header->cols == 0
+        // Checked before computing the words per row so that can not wrap around to 0.
+        || header->cols > UINT64_MAX - (BIT_ARRAY_WORD_BITS - 1)
+        || header->words_per_row == 0
+        || header->words_per_row != (header->cols + BIT_ARRAY_WORD_BITS - 1) / BIT_ARRAY_WORD_BITS
+        || header->rows > (size - sizeof(Snapshot_Header)) / sizeof(uint64_t) / header->words_per_row
+    ) {
+        error = "is truncated or has an invalid size";
+    } else
+    if (header->cols % BIT_ARRAY_WORD_BITS != 0) {
+        // The bitpacked engine steps the mapped words as they are, so bits past the last
+        // column would be alive neighbors of it.
+        const uint64_t *words = (const uint64_t *)((const char *)mapping + sizeof(Snapshot_Header));
+        const uint64_t padding_mask = ~((UINT64_C(1) << (header->cols % BIT_ARRAY_WORD_BITS)) - 1);
+        for (uint64_t row = 0; row < header->rows; row++) {
+            if ((words[(row + 1) * header->words_per_row - 1] & padding_mask) != 0) {
+                error = "has alive cells past its last column";
+                break;
+            }
+        }
+    }
+    if (error != NULL) {
+        PRINT_ERR("\"%s\" %s!\n", path, error);
+        munmap(mapping, size);
+        exit(EX_SNAPSHOT_ERROR);
+    }
+
+    return (Snapshot){
+        .mapping = mapping,
+        .size = size,
+        .header = header,
+        .words = (uint64_t *)((char *)mapping + sizeof(Snapshot_Header)),
+    };
+}
+
+/**
+*   Restores the generation of `snapshot` into a simulation of the same size.
+*
+*   The bitpacked engine uses the mapped cells as they are, pages are only read in when the
+*   first step touches them, and the simulation owns the mapping from then on.
+*   The bool engine copies the alive runs out and unmaps the snapshot right away.
+*/
+void simulation_load_snapshot(Simulation *simulation, const Snapshot snapshot) {
+    const Snapshot_Header *header = snapshot.header;
+    simulation->generation = header->generation;
+
+    if (simulation->engine == ENGINE_BITPACKED) {
+        free(simulation->bits_front.words);
+        simulation->bits_front.words = snapshot.words;
+        simulation->snapshot_mapping = snapshot.mapping;
+        simulation->snapshot_mapping_size = snapshot.size;
+        simulation->front_is_stale = true;
+        return;
+    }
+
+    madvise(snapshot.mapping, snapshot.size, MADV_SEQUENTIAL);
+    for (size_t row = 0; row < header->rows; row++) {
+        const uint64_t *words = &snapshot.words[row * header->words_per_row];
+        size_t col = 0;
+        while (col < header->cols) {
+            const uint64_t word = words[col / BIT_ARRAY_WORD_BITS] >> (col % BIT_ARRAY_WORD_BITS);
+            if (word == 0) {
+                col = (col / BIT_ARRAY_WORD_BITS + 1) * BIT_ARRAY_WORD_BITS;
+                continue;
+            }
+            // Skip to the next alive cell, then measure the run of alive cells starting there.
+            col += __builtin_ctzll(word);
+            size_t run_end = col;
+            while (run_end < header->cols && (words[run_end / BIT_ARRAY_WORD_BITS] >> (run_end % BIT_ARRAY_WORD_BITS)) & 1) {
+                run_end++;
+            }
+            simulation_set_alive_run(simulation, row, col, run_end - col);
+            col = run_end;
+        }
+    }
+    munmap(snapshot.mapping, snapshot.size);
+}
+
+/**
+*   Saves a snapshot when checkpoints are enabled and the current generation is due for one.
+*/
+static inline void simulation_checkpoint(Simulation *simulation) {
+    if (simulation->checkpoint_path != NULL
+        && simulation->checkpoint_every != 0
+        && simulation->generation % simulation->checkpoint_every == 0
+    ) {
+        STATS_BEGIN(STATS_PHASE_CHECKPOINT);
+        simulation_save_snapshot(simulation, simulation->checkpoint_path);
+        STATS_END(STATS_PHASE_CHECKPOINT);
+    }
+}
+
+/**
+*   Writes every `every`th generation from now on into `dir` as PBM or PGM images, see `Frame_Writer`.
+*   Exits when `dir` can not be created.
+*/
+void simulation_dump_frames(
+    Simulation *simulation,
+    const char *dir,
+    const Frame_Format format,
+    const uint64_t every,
+    const bool drop_when_full
+) {
+    Frame_Writer *frames = malloc(sizeof(Frame_Writer));
+    if (frames == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the frame writer!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    frame_writer_open(
+        frames, dir, format, every, drop_when_full,
+        simulation->rows, simulation->cols,
+        simulation->engine == ENGINE_BITPACKED
+    );
+    simulation->frames = frames;
+}
+
+// Queues the current generation for the frame writer if it is one of every `every` generations.
+static inline void simulation_dump_frame(Simulation *simulation) {
+    Frame_Writer *frames = simulation->frames;
+    if (frames == NULL || simulation->generation % frames->every != 0) {
+        return;
+    }
+
+    STATS_BEGIN(STATS_PHASE_FRAME);
+    Frame *frame = frame_writer_reserve(frames);
+    if (frame != NULL) {
+        frame->generation = simulation->generation;
+        switch (simulation->engine) {
+        case ENGINE_BOOL: {
+            memcpy(frame->cells.cells, simulation->front.cells, frame->cells.rows * frame->cells.stride);
+            break;
+        }
+
+        case ENGINE_BITPACKED: {
+            const Bit_Array_2d bits = simulation->bits_front;
+            memcpy(frame->bits.words, bits.words, bits.rows * bits.words_per_row * sizeof(uint64_t));
+            break;
+        }
+
+        case ENGINE_HASHLIFE: hashlife_write_cells(simulation->hashlife, &frame->cells); break;
+        case ENGINE_SPARSE:   sparse_write_cells(simulation->sparse, &frame->cells);     break;
+        }
+        frame_writer_push(frames);
+    }
+    STATS_END(STATS_PHASE_FRAME);
+}
+
+/**
+*   Computes the next generation of the cells `[col_begin, col_end)` of one row.
+*
+*   All 8 neighbors of those cells have to be readable, which the ghost border of a
+*   Cell Array guarantees for every cell. This lets the kernels read neighbors without any checks.
+*/
+typedef void (*Row_Kernel)(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    size_t col_begin, size_t col_end
+);
+
+/**
+*   Like `Row_Kernel` but also adds the cells that were born and died to `counts` for the metrics.
+*
+*   # Returns
+*
+*   If any of the new cells is alive.
+*/
+typedef bool (*Row_Count_Kernel)(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    size_t col_begin, size_t col_end,
+    Generation_Counts *counts
+);
+
+// Cells are 0 or 1, so the number of alive cells before and after and of the changed ones
+// give both: births - deaths is after - before and births + deaths is changed.
+static inline void generation_counts_add_changes(
+    Generation_Counts *counts, const uint64_t alive_before, const uint64_t alive_after, const uint64_t changed
+) {
+    counts->births += (changed + alive_after - alive_before) / 2;
+    counts->deaths += (changed + alive_before - alive_after) / 2;
+}
+
+// The row steps below are the bodies of both kinds of kernels. Every kernel inlines one with
+// a constant `counts`, so the counting only exists in the ones that get a `Generation_Counts`.
+
+static inline __attribute__((always_inline)) bool row_step_scalar(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    uint64_t alive_before = 0;
+    uint64_t alive_after = 0;
+    uint64_t changed = 0;
+    for (size_t col = col_begin; col < col_end; col++) {
+        const uint8_t alive_neighbor_count =
+            above[col - 1] + above[col] + above[col + 1] +
+            center[col - 1]             + center[col + 1] +
+            below[col - 1] + below[col] + below[col + 1];
+
+        // B3/S23 without branches: (3 | alive) and (2 | 1) are the only ways to get 3.
+        const bool next = (alive_neighbor_count | center[col]) == 3;
+        new_cells[col] = next;
+        if (counts != NULL) {
+            alive_before += center[col];
+            alive_after += next;
+            changed += center[col] != next;
+        }
+    }
+
+    if (counts != NULL) {
+        generation_counts_add_changes(counts, alive_before, alive_after, changed);
+    }
+    return alive_after != 0;
+}
+
+// Like `row_step_scalar` but for any rule, looks the next state up in `rule_table`.
+static inline __attribute__((always_inline)) bool row_step_table_scalar(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    uint64_t alive_before = 0;
+    uint64_t alive_after = 0;
+    uint64_t changed = 0;
+    for (size_t col = col_begin; col < col_end; col++) {
+        const uint8_t alive_neighbor_count =
+            above[col - 1] + above[col] + above[col + 1] +
+            center[col - 1]             + center[col + 1] +
+            below[col - 1] + below[col] + below[col + 1];
+
+        const bool next = rule_table[center[col]][alive_neighbor_count];
+        new_cells[col] = next;
+        if (counts != NULL) {
+            alive_before += center[col];
+            alive_after += next;
+            changed += center[col] != next;
+        }
+    }
+
+    if (counts != NULL) {
+        generation_counts_add_changes(counts, alive_before, alive_after, changed);
+    }
+    return alive_after != 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The vector kernels do the same as the scalar ones, one byte per cell, and leave the
+// remaining cells that do not fill a whole vector to them.
+// The table kernels look both rows of `rule_table` up with a byte shuffle and pick one by
+// the state of the cell.
+
+// The alive neighbor counts of the cells `[col, col + 16)`.
+__attribute__((target("sse2"), always_inline))
+static inline __m128i row_neighbor_count_128(const bool *above, const bool *center, const bool *below, const size_t col) {
+    #define LOAD_128(ptr) _mm_loadu_si128((const __m128i *)(ptr))
+    __m128i count = _mm_add_epi8(LOAD_128(&above[col - 1]), LOAD_128(&above[col]));
+    count = _mm_add_epi8(count, LOAD_128(&above[col + 1]));
+    count = _mm_add_epi8(count, LOAD_128(&center[col - 1]));
+    count = _mm_add_epi8(count, LOAD_128(&center[col + 1]));
+    count = _mm_add_epi8(count, LOAD_128(&below[col - 1]));
+    count = _mm_add_epi8(count, LOAD_128(&below[col]));
+    count = _mm_add_epi8(count, LOAD_128(&below[col + 1]));
+    #undef LOAD_128
+    return count;
+}
+
+// The alive neighbor counts of the cells `[col, col + 32)`.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i row_neighbor_count_256(const bool *above, const bool *center, const bool *below, const size_t col) {
+    #define LOAD_256(ptr) _mm256_loadu_si256((const __m256i *)(ptr))
+    __m256i count = _mm256_add_epi8(LOAD_256(&above[col - 1]), LOAD_256(&above[col]));
+    count = _mm256_add_epi8(count, LOAD_256(&above[col + 1]));
+    count = _mm256_add_epi8(count, LOAD_256(&center[col - 1]));
+    count = _mm256_add_epi8(count, LOAD_256(&center[col + 1]));
+    count = _mm256_add_epi8(count, LOAD_256(&below[col - 1]));
+    count = _mm256_add_epi8(count, LOAD_256(&below[col]));
+    count = _mm256_add_epi8(count, LOAD_256(&below[col + 1]));
+    #undef LOAD_256
+    return count;
+}
+
+// The alive neighbor counts of the cells `[col, col + 64)`.
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline __m512i row_neighbor_count_512(const bool *above, const bool *center, const bool *below, const size_t col) {
+    #define LOAD_512(ptr) _mm512_loadu_si512((const void *)(ptr))
+    __m512i count = _mm512_add_epi8(LOAD_512(&above[col - 1]), LOAD_512(&above[col]));
+    count = _mm512_add_epi8(count, LOAD_512(&above[col + 1]));
+    count = _mm512_add_epi8(count, LOAD_512(&center[col - 1]));
+    count = _mm512_add_epi8(count, LOAD_512(&center[col + 1]));
+    count = _mm512_add_epi8(count, LOAD_512(&below[col - 1]));
+    count = _mm512_add_epi8(count, LOAD_512(&below[col]));
+    count = _mm512_add_epi8(count, LOAD_512(&below[col + 1]));
+    #undef LOAD_512
+    return count;
+}
+
+// The counting vector kernels add the old cells, the new cells and the changed ones up in
+// bytes, which `sad` sums into 64 bit lanes before one of them can overflow.
+#define ROW_COUNTS_FLUSH_INTERVAL UINT8_MAX
+
+typedef struct {
+    __m128i before;
+    __m128i after;
+    __m128i changed;
+    __m128i before_sum;
+    __m128i after_sum;
+    __m128i changed_sum;
+    size_t pending;
+} Row_Counts_128;
+
+__attribute__((target("sse2"), always_inline))
+static inline Row_Counts_128 row_counts_init_128(void) {
+    const __m128i zero = _mm_setzero_si128();
+    return (Row_Counts_128){ zero, zero, zero, zero, zero, zero, 0 };
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline void row_counts_add_128(Row_Counts_128 *row_counts, const __m128i before, const __m128i after) {
+    row_counts->before = _mm_add_epi8(row_counts->before, before);
+    row_counts->after = _mm_add_epi8(row_counts->after, after);
+    row_counts->changed = _mm_add_epi8(row_counts->changed, _mm_xor_si128(before, after));
+
+    if (++row_counts->pending == ROW_COUNTS_FLUSH_INTERVAL) {
+        const __m128i zero = _mm_setzero_si128();
+        row_counts->before_sum = _mm_add_epi64(row_counts->before_sum, _mm_sad_epu8(row_counts->before, zero));
+        row_counts->after_sum = _mm_add_epi64(row_counts->after_sum, _mm_sad_epu8(row_counts->after, zero));
+        row_counts->changed_sum = _mm_add_epi64(row_counts->changed_sum, _mm_sad_epu8(row_counts->changed, zero));
+        row_counts->before = zero;
+        row_counts->after = zero;
+        row_counts->changed = zero;
+        row_counts->pending = 0;
+    }
+}
+
+// Adds what `row_counts` counted to `counts` and returns if any new cell is alive.
+__attribute__((target("sse2"), always_inline))
+static inline bool row_counts_finish_128(Row_Counts_128 *row_counts, Generation_Counts *counts) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t before[2];
+    uint64_t after[2];
+    uint64_t changed[2];
+    _mm_storeu_si128((__m128i *)before, _mm_add_epi64(row_counts->before_sum, _mm_sad_epu8(row_counts->before, zero)));
+    _mm_storeu_si128((__m128i *)after, _mm_add_epi64(row_counts->after_sum, _mm_sad_epu8(row_counts->after, zero)));
+    _mm_storeu_si128((__m128i *)changed, _mm_add_epi64(row_counts->changed_sum, _mm_sad_epu8(row_counts->changed, zero)));
+
+    generation_counts_add_changes(counts, before[0] + before[1], after[0] + after[1], changed[0] + changed[1]);
+    return after[0] + after[1] != 0;
+}
+
+typedef struct {
+    __m256i before;
+    __m256i after;
+    __m256i changed;
+    __m256i before_sum;
+    __m256i after_sum;
+    __m256i changed_sum;
+    size_t pending;
+} Row_Counts_256;
+
+__attribute__((target("avx2"), always_inline))
+static inline Row_Counts_256 row_counts_init_256(void) {
+    const __m256i zero = _mm256_setzero_si256();
+    return (Row_Counts_256){ zero, zero, zero, zero, zero, zero, 0 };
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void row_counts_add_256(Row_Counts_256 *row_counts, const __m256i before, const __m256i after) {
+    row_counts->before = _mm256_add_epi8(row_counts->before, before);
+    row_counts->after = _mm256_add_epi8(row_counts->after, after);
+    row_counts->changed = _mm256_add_epi8(row_counts->changed, _mm256_xor_si256(before, after));
+
+    if (++row_counts->pending == ROW_COUNTS_FLUSH_INTERVAL) {
+        const __m256i zero = _mm256_setzero_si256();
+        row_counts->before_sum = _mm256_add_epi64(row_counts->before_sum, _mm256_sad_epu8(row_counts->before, zero));
+        row_counts->after_sum = _mm256_add_epi64(row_counts->after_sum, _mm256_sad_epu8(row_counts->after, zero));
+        row_counts->changed_sum = _mm256_add_epi64(row_counts->changed_sum, _mm256_sad_epu8(row_counts->changed, zero));
+        row_counts->before = zero;
+        row_counts->after = zero;
+        row_counts->changed = zero;
+        row_counts->pending = 0;
+    }
+}
+
+// Adds what `row_counts` counted to `counts` and returns if any new cell is alive.
+__attribute__((target("avx2"), always_inline))
+static inline bool row_counts_finish_256(Row_Counts_256 *row_counts, Generation_Counts *counts) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t before[4];
+    uint64_t after[4];
+    uint64_t changed[4];
+    _mm256_storeu_si256((__m256i *)before, _mm256_add_epi64(row_counts->before_sum, _mm256_sad_epu8(row_counts->before, zero)));
+    _mm256_storeu_si256((__m256i *)after, _mm256_add_epi64(row_counts->after_sum, _mm256_sad_epu8(row_counts->after, zero)));
+    _mm256_storeu_si256((__m256i *)changed, _mm256_add_epi64(row_counts->changed_sum, _mm256_sad_epu8(row_counts->changed, zero)));
+
+    const uint64_t alive_after = after[0] + after[1] + after[2] + after[3];
+    generation_counts_add_changes(
+        counts, before[0] + before[1] + before[2] + before[3], alive_after, changed[0] + changed[1] + changed[2] + changed[3]
+    );
+    return alive_after != 0;
+}
+
+typedef struct {
+    __m512i before;
+    __m512i after;
+    __m512i changed;
+    __m512i before_sum;
+    __m512i after_sum;
+    __m512i changed_sum;
+    size_t pending;
+} Row_Counts_512;
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline Row_Counts_512 row_counts_init_512(void) {
+    const __m512i zero = _mm512_setzero_si512();
+    return (Row_Counts_512){ zero, zero, zero, zero, zero, zero, 0 };
+}
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline void row_counts_add_512(Row_Counts_512 *row_counts, const __m512i before, const __m512i after) {
+    row_counts->before = _mm512_add_epi8(row_counts->before, before);
+    row_counts->after = _mm512_add_epi8(row_counts->after, after);
+    row_counts->changed = _mm512_add_epi8(row_counts->changed, _mm512_xor_si512(before, after));
+
+    if (++row_counts->pending == ROW_COUNTS_FLUSH_INTERVAL) {
+        const __m512i zero = _mm512_setzero_si512();
+        row_counts->before_sum = _mm512_add_epi64(row_counts->before_sum, _mm512_sad_epu8(row_counts->before, zero));
+        row_counts->after_sum = _mm512_add_epi64(row_counts->after_sum, _mm512_sad_epu8(row_counts->after, zero));
+        row_counts->changed_sum = _mm512_add_epi64(row_counts->changed_sum, _mm512_sad_epu8(row_counts->changed, zero));
+        row_counts->before = zero;
+        row_counts->after = zero;
+        row_counts->changed = zero;
+        row_counts->pending = 0;
+    }
+}
+
+// Adds what `row_counts` counted to `counts` and returns if any new cell is alive.
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline bool row_counts_finish_512(Row_Counts_512 *row_counts, Generation_Counts *counts) {
+    const __m512i zero = _mm512_setzero_si512();
+    const uint64_t alive_after = _mm512_reduce_add_epi64(_mm512_add_epi64(row_counts->after_sum, _mm512_sad_epu8(row_counts->after, zero)));
+    generation_counts_add_changes(
+        counts,
+        _mm512_reduce_add_epi64(_mm512_add_epi64(row_counts->before_sum, _mm512_sad_epu8(row_counts->before, zero))),
+        alive_after,
+        _mm512_reduce_add_epi64(_mm512_add_epi64(row_counts->changed_sum, _mm512_sad_epu8(row_counts->changed, zero)))
+    );
+    return alive_after != 0;
+}
+
+__attribute__((target("sse2"), always_inline))
+static inline bool row_step_sse2(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i threes = _mm_set1_epi8(3);
+    Row_Counts_128 row_counts = row_counts_init_128();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m128i) <= col_end; col += sizeof(__m128i)) {
+        const __m128i count = row_neighbor_count_128(above, center, below, col);
+        const __m128i alive = _mm_loadu_si128((const __m128i *)&center[col]);
+
+        const __m128i is_three = _mm_cmpeq_epi8(_mm_or_si128(count, alive), threes);
+        const __m128i next = _mm_and_si128(is_three, ones);
+        _mm_storeu_si128((__m128i *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_128(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_128(&row_counts, counts);
+    return row_step_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+
+__attribute__((target("ssse3"), always_inline))
+static inline bool row_step_table_ssse3(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i birth = _mm_loadu_si128((const __m128i *)rule_table[0]);
+    const __m128i survival = _mm_loadu_si128((const __m128i *)rule_table[1]);
+    Row_Counts_128 row_counts = row_counts_init_128();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m128i) <= col_end; col += sizeof(__m128i)) {
+        const __m128i count = row_neighbor_count_128(above, center, below, col);
+        const __m128i alive = _mm_loadu_si128((const __m128i *)&center[col]);
+        const __m128i is_alive = _mm_cmpeq_epi8(alive, ones);
+
+        const __m128i next = _mm_or_si128(
+            _mm_andnot_si128(is_alive, _mm_shuffle_epi8(birth, count)),
+            _mm_and_si128(is_alive, _mm_shuffle_epi8(survival, count))
+        );
+        _mm_storeu_si128((__m128i *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_128(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_128(&row_counts, counts);
+    return row_step_table_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline bool row_step_avx2(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i threes = _mm256_set1_epi8(3);
+    Row_Counts_256 row_counts = row_counts_init_256();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m256i) <= col_end; col += sizeof(__m256i)) {
+        const __m256i count = row_neighbor_count_256(above, center, below, col);
+        const __m256i alive = _mm256_loadu_si256((const __m256i *)&center[col]);
+
+        const __m256i is_three = _mm256_cmpeq_epi8(_mm256_or_si256(count, alive), threes);
+        const __m256i next = _mm256_and_si256(is_three, ones);
+        _mm256_storeu_si256((__m256i *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_256(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_256(&row_counts, counts);
+    return row_step_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline bool row_step_table_avx2(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m256i ones = _mm256_set1_epi8(1);
+    // The shuffle works within each 128 bit lane, so both lanes get the whole table.
+    const __m256i birth = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)rule_table[0]));
+    const __m256i survival = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)rule_table[1]));
+    Row_Counts_256 row_counts = row_counts_init_256();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m256i) <= col_end; col += sizeof(__m256i)) {
+        const __m256i count = row_neighbor_count_256(above, center, below, col);
+        const __m256i alive = _mm256_loadu_si256((const __m256i *)&center[col]);
+        const __m256i is_alive = _mm256_cmpeq_epi8(alive, ones);
+
+        const __m256i next = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(birth, count), _mm256_shuffle_epi8(survival, count), is_alive
+        );
+        _mm256_storeu_si256((__m256i *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_256(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_256(&row_counts, counts);
+    return row_step_table_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline bool row_step_avx512(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m512i ones = _mm512_set1_epi8(1);
+    const __m512i threes = _mm512_set1_epi8(3);
+    Row_Counts_512 row_counts = row_counts_init_512();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m512i) <= col_end; col += sizeof(__m512i)) {
+        const __m512i count = row_neighbor_count_512(above, center, below, col);
+        const __m512i alive = _mm512_loadu_si512((const void *)&center[col]);
+
+        const __mmask64 is_three = _mm512_cmpeq_epi8_mask(_mm512_or_si512(count, alive), threes);
+        const __m512i next = _mm512_maskz_mov_epi8(is_three, ones);
+        _mm512_storeu_si512((void *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_512(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_512(&row_counts, counts);
+    return row_step_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline bool row_step_table_avx512(
+    const bool *above, const bool *center, const bool *below,
+    bool *new_cells,
+    const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    const __m512i birth = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)rule_table[0]));
+    const __m512i survival = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)rule_table[1]));
+    Row_Counts_512 row_counts = row_counts_init_512();
+
+    size_t col = col_begin;
+    for (; col + sizeof(__m512i) <= col_end; col += sizeof(__m512i)) {
+        const __m512i count = row_neighbor_count_512(above, center, below, col);
+        const __m512i alive = _mm512_loadu_si512((const void *)&center[col]);
+
+        const __mmask64 is_alive = _mm512_test_epi8_mask(alive, alive);
+        const __m512i next = _mm512_mask_blend_epi8(
+            is_alive, _mm512_shuffle_epi8(birth, count), _mm512_shuffle_epi8(survival, count)
+        );
+        _mm512_storeu_si512((void *)&new_cells[col], next);
+        if (counts != NULL) {
+            row_counts_add_512(&row_counts, alive, next);
+        }
+    }
+
+    const bool any_alive = counts != NULL && row_counts_finish_512(&row_counts, counts);
+    return row_step_table_scalar(above, center, below, new_cells, col, col_end, counts) || any_alive;
+}
+#endif
+
+// Every row step as a `Row_Kernel` and a `Row_Count_Kernel`, compiled with the target `attributes`.
+// Like the bitpacked ones the counting kernels count into a local copy that can not be NULL.
+#define ROW_KERNELS(name, attributes)                                                                          \
+    attributes static void row_kernel_##name(                                                                \
+        const bool *above, const bool *center, const bool *below,                                          \
+        bool *new_cells,                                                                                   \
+        const size_t col_begin, const size_t col_end                                                       \
+    ) {                                                                                                    \
+        row_step_##name(above, center, below, new_cells, col_begin, col_end, NULL);                        \
+    }                                                                                                      \
+    attributes static bool row_count_kernel_##name(                                                          \
+        const bool *above, const bool *center, const bool *below,                                          \
+        bool *new_cells,                                                                                   \
+        const size_t col_begin, const size_t col_end,                                                      \
+        Generation_Counts *counts                                                                          \
+    ) {                                                                                                    \
+        Generation_Counts row_counts = *counts;                                                            \
+        const bool any_alive = row_step_##name(above, center, below, new_cells, col_begin, col_end, &row_counts);\
+        *counts = row_counts;                                                                              \
+        return any_alive;                                                                                  \
+    }
+ROW_KERNELS(scalar, )
+ROW_KERNELS(table_scalar, )
+#if defined(__x86_64__) || defined(__i386__)
+ROW_KERNELS(sse2, __attribute__((target("sse2"))))
+ROW_KERNELS(table_ssse3, __attribute__((target("ssse3"))))
+ROW_KERNELS(avx2, __attribute__((target("avx2"))))
+ROW_KERNELS(table_avx2, __attribute__((target("avx2"))))
+ROW_KERNELS(avx512, __attribute__((target("avx512f,avx512bw"))))
+ROW_KERNELS(table_avx512, __attribute__((target("avx512f,avx512bw"))))
+#endif
+#undef ROW_KERNELS
+
+static Row_Kernel row_kernel = row_kernel_scalar;
+static Row_Count_Kernel row_count_kernel = row_count_kernel_scalar;
+static const char *row_kernel_name = "scalar";
+
+/**
+*   Adds the cells that were born and died between the words `[0, word_count)` of
+*   `old_words` and `new_words` to `counts`.
+*/
+typedef void (*Words_Count_Kernel)(const uint64_t *old_words, const uint64_t *new_words, size_t word_count, Generation_Counts *counts);
+
+static inline __attribute__((always_inline)) void words_count_changes(
+    const uint64_t *old_words, const uint64_t *new_words, const size_t word_count, Generation_Counts *counts
+) {
+    uint64_t births = 0;
+    uint64_t deaths = 0;
+    for (size_t idx = 0; idx < word_count; idx++) {
+        births += __builtin_popcountll(new_words[idx] & ~old_words[idx]);
+        deaths += __builtin_popcountll(old_words[idx] & ~new_words[idx]);
+    }
+    counts->births += births;
+    counts->deaths += deaths;
+}
+
+static void words_count_changes_scalar(
+    const uint64_t *old_words, const uint64_t *new_words, const size_t word_count, Generation_Counts *counts
+) {
+    words_count_changes(old_words, new_words, word_count, counts);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Without the instruction every popcount is a dozen bit tricks, which costs more than stepping the word.
+__attribute__((target("popcnt")))
+static void words_count_changes_popcnt(
+    const uint64_t *old_words, const uint64_t *new_words, const size_t word_count, Generation_Counts *counts
+) {
+    words_count_changes(old_words, new_words, word_count, counts);
+}
+#endif
+
+static Words_Count_Kernel words_count_kernel = words_count_changes_scalar;
+
+/**
+*   Picks the widest row kernel the CPU supports, both the plain and the counting one, and
+*   the popcount kernel the sparse metrics count with. Called once at startup after `rule_select`.
+*
+*   B3/S23 has its own kernels, every other rule goes through the table kernels.
+*/
+void row_kernel_select(void) {
+    const bool is_conway = rule_equals(life_rule, RULE_CONWAY);
+    row_kernel = is_conway ? row_kernel_scalar : row_kernel_table_scalar;
+    row_count_kernel = is_conway ? row_count_kernel_scalar : row_count_kernel_table_scalar;
+    row_kernel_name = is_conway ? "scalar" : "scalar table";
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        row_kernel = is_conway ? row_kernel_avx512 : row_kernel_table_avx512;
+        row_count_kernel = is_conway ? row_count_kernel_avx512 : row_count_kernel_table_avx512;
+        row_kernel_name = is_conway ? "avx512" : "avx512 table";
+    } else
+    if (__builtin_cpu_supports("avx2")) {
+        row_kernel = is_conway ? row_kernel_avx2 : row_kernel_table_avx2;
+        row_count_kernel = is_conway ? row_count_kernel_avx2 : row_count_kernel_table_avx2;
+        row_kernel_name = is_conway ? "avx2" : "avx2 table";
+    } else
+    if (is_conway && __builtin_cpu_supports("sse2")) {
+        row_kernel = row_kernel_sse2;
+        row_count_kernel = row_count_kernel_sse2;
+        row_kernel_name = "sse2";
+    } else
+    if (!is_conway && __builtin_cpu_supports("ssse3")) {
+        row_kernel = row_kernel_table_ssse3;
+        row_count_kernel = row_count_kernel_table_ssse3;
+        row_kernel_name = "ssse3 table";
+    }
+
+    if (__builtin_cpu_supports("popcnt")) {
+        words_count_kernel = words_count_changes_popcnt;
+    }
+#endif
+}
+
+/**
+*   Computes the next generation of the cells `[col_begin, col_end)` of one row of `grid`
+*   into `new_grid`.
+*
+*   Unless `counts` is NULL the cells that were born and died are added to it and the alive
+*   ones to its bounding box.
+*/
+void cell_array_step_row(
+    const Cell_Array_2d *grid, const Cell_Array_2d new_grid,
+    const size_t row, const size_t col_begin, const size_t col_end,
+    Generation_Counts *counts
+) {
+    // The edges read their missing neighbors from the ghost border, so every cell takes the same path.
+    const bool *cells = cell_array_row(*grid, row);
+    bool *new_cells = cell_array_row(new_grid, row);
+    if (counts == NULL) {
+        row_kernel(cells - grid->stride, cells, cells + grid->stride, new_cells, col_begin, col_end);
+    } else
+    if (row_count_kernel(cells - grid->stride, cells, cells + grid->stride, new_cells, col_begin, col_end, counts)) {
+        bounding_box_add_cells(&counts->box, new_cells, row, col_begin, col_end);
+    }
+}
+
+/**
+*   Computes the next generation of the rows `[row_begin, row_end)` of `grid` into `new_grid`,
+*   counting the changes into `counts` unless it is NULL.
+*/
+void cell_array_step(
+    const Cell_Array_2d *grid, const Cell_Array_2d new_grid,
+    const size_t row_begin, const size_t row_end,
+    Generation_Counts *counts
+) {
+    for (size_t row = row_begin; row < row_end; row++) {
+        cell_array_step_row(grid, new_grid, row, 0, grid->cols, counts);
+    }
+}
+
+// Where a word of cells is, mixed into its hash so equal words in different places differ.
+static inline uint64_t word_position_key(const int64_t row, const int64_t col) {
+    return splitmix64((uint64_t)row * 0x9E3779B97F4A7C15 ^ (uint64_t)col);
+}
+
+/**
+*   # Returns
+*
+*   The hash of the word of cells `word` in row `row` and word column `col`, see `Cycle_Detector`.
+*   Empty words hash to 0 so the engines can skip them.
+*/
+static inline uint64_t word_hash(const uint64_t word, const int64_t row, const int64_t col) {
+    return word != 0 ? splitmix64(word ^ word_position_key(row, col)) : 0;
+}
+
+// How the hash changes when the word in row `row` and word column `col` changes from `old_word` to `new_word`.
+static inline uint64_t word_hash_change(const uint64_t old_word, const uint64_t new_word, const int64_t row, const int64_t col) {
+    const uint64_t key = word_position_key(row, col);
+    return (old_word != 0 ? splitmix64(old_word ^ key) : 0) ^ (new_word != 0 ? splitmix64(new_word ^ key) : 0);
+}
+
+/**
+*   # Returns
+*
+*   The cells `[col, col + 64)` of a bool row packed into a word like the ones of a
+*   `Bit_Array_2d`. Cells from `col_end` on are left out.
+*/
+static inline uint64_t cells_pack_word(const bool *cells, const size_t col, const size_t col_end) {
+    if (col + BIT_ARRAY_WORD_BITS > col_end) {
+        uint64_t word = 0;
+        for (size_t idx = 0; col + idx < col_end; idx++) {
+            word |= (uint64_t)cells[col + idx] << idx;
+        }
+        return word;
+    }
+
+    uint64_t word = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    // SSE2 is always there. Moving bit 0 of every byte up to bit 7 lets movemask gather them.
+    for (size_t idx = 0; idx < BIT_ARRAY_WORD_BITS; idx += sizeof(__m128i)) {
+        const __m128i bytes = _mm_loadu_si128((const __m128i *)&cells[col + idx]);
+        word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_slli_epi16(bytes, 7)) << idx;
+    }
+#else
+    for (size_t idx = 0; idx < BIT_ARRAY_WORD_BITS; idx += sizeof(uint64_t)) {
+        uint64_t bytes;
+        memcpy(&bytes, &cells[col + idx], sizeof(uint64_t));
+        // Every byte is 0 or 1, the multiplication gathers byte `i` into bit `56 + i`.
+        word |= ((bytes * UINT64_C(0x0102040810204080)) >> 56) << idx;
+    }
+#endif
+    return word;
+}
+
+/**
+*   # Returns
+*
+*   How the hash changes from the cells `[col_begin, col_end)` of `row` that differ between
+*   `old_cells` and `new_cells`. `col_begin` has to be a multiple of 64.
+*/
+uint64_t cells_hash_delta(
+    const bool *old_cells, const bool *new_cells,
+    const size_t row, const size_t col_begin, const size_t col_end
+) {
+    uint64_t hash = 0;
+    for (size_t col = col_begin; col < col_end; col += BIT_ARRAY_WORD_BITS) {
+        const uint64_t old_word = cells_pack_word(old_cells, col, col_end);
+        const uint64_t new_word = cells_pack_word(new_cells, col, col_end);
+        if (old_word != new_word) {
+            hash ^= word_hash_change(old_word, new_word, row, col / BIT_ARRAY_WORD_BITS);
+        }
+    }
+    return hash;
+}
+
+/**
+*   # Returns
+*
+*   The hash of the current generation from scratch, see `Cycle_Detector`.
+*/
+uint64_t simulation_hash(Simulation *simulation) {
+    uint64_t hash = 0;
+    switch (simulation->engine) {
+    case ENGINE_BOOL: {
+        for (size_t row = 0; row < simulation->rows; row++) {
+            const bool *cells = cell_array_row(simulation->front, row);
+            for (size_t col = 0; col < simulation->cols; col += BIT_ARRAY_WORD_BITS) {
+                hash ^= word_hash(cells_pack_word(cells, col, simulation->cols), row, col / BIT_ARRAY_WORD_BITS);
+            }
+        }
+        break;
+    }
+
+    case ENGINE_BITPACKED: {
+        for (size_t row = 0; row < simulation->rows; row++) {
+            const uint64_t *words = bit_array_row(simulation->bits_front, row);
+            for (size_t word_idx = 0; word_idx < simulation->bits_front.words_per_row; word_idx++) {
+                hash ^= word_hash(words[word_idx], row, word_idx);
+            }
+        }
+        break;
+    }
+
+    // Rejected by `parse_arguments`, the tree has no cells to hash one by one.
+    case ENGINE_HASHLIFE: break;
+
+    case ENGINE_SPARSE: {
+        const Sparse_Universe *sparse = simulation->sparse;
+        for (size_t idx = 0; idx < sparse->chunk_count; idx++) {
+            const Chunk *chunk = sparse->chunks[idx];
+            for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+                hash ^= word_hash(
+                    chunk->cells[sparse->front][cell_row], chunk->chunk_row * CHUNK_SIZE + (int64_t)cell_row, chunk->chunk_col
+                );
+            }
+        }
+        break;
+    }
+    }
+    return hash;
+}
+
+// If the workers should hash the cells they change in this generation.
+static inline bool simulation_tracks_hash(const Simulation *simulation) {
+    return simulation->cycles != NULL && simulation->cycles->period == 0;
+}
+
+/**
+*   # Returns
+*
+*   How the hash changes from the cells in the rows `[row_begin, row_end)` and columns
+*   `[col_begin, col_end)` of the bool or bitpacked grid that differ between the front and
+*   back grid. The bitpacked engine hashes the whole words of those columns.
+*/
+uint64_t grid_hash_delta(
+    const Simulation *simulation,
+    const size_t row_begin, const size_t row_end,
+    const size_t col_begin, const size_t col_end
+) {
+    uint64_t hash = 0;
+    for (size_t row = row_begin; row < row_end; row++) {
+        if (simulation->engine == ENGINE_BOOL) {
+            hash ^= cells_hash_delta(
+                cell_array_row(simulation->front, row), cell_array_row(simulation->back, row),
+                row, col_begin, col_end
+            );
+            continue;
+        }
+
+        const uint64_t *old_words = bit_array_row(simulation->bits_front, row);
+        const uint64_t *new_words = bit_array_row(simulation->bits_back, row);
+        const size_t word_end = (col_end + BIT_ARRAY_WORD_BITS - 1) / BIT_ARRAY_WORD_BITS;
+        for (size_t word_idx = col_begin / BIT_ARRAY_WORD_BITS; word_idx < word_end; word_idx++) {
+            if (old_words[word_idx] != new_words[word_idx]) {
+                hash ^= word_hash_change(old_words[word_idx], new_words[word_idx], row, word_idx);
+            }
+        }
+    }
+    return hash;
+}
+
+/**
+*   Finds cycles from now on and either stops the simulation at the first one or jumps over
+*   whole periods of it in `simulation_advance`.
+*/
+void simulation_detect_cycles(Simulation *simulation, const Cycle_Action action) {
+    const size_t worker_count = simulation->pool != NULL ? simulation->pool->worker_count : 1;
+
+    simulation->cycles = calloc(1, sizeof(Cycle_Detector));
+    if (simulation->cycles == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the cycle detection!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    simulation->cycles->action = action;
+    simulation->cycles->hash_is_stale = true;
+    simulation->cycles->worker_count = worker_count;
+    simulation->cycles->worker_hash_deltas = calloc(worker_count, sizeof(uint64_t));
+    if (simulation->cycles->worker_hash_deltas == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the cycle detection!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+}
+
+// Hashes the current generation from scratch if it was edited. Called before stepping.
+void cycle_detector_begin(Simulation *simulation) {
+    Cycle_Detector *cycles = simulation->cycles;
+    if (cycles == NULL || cycles->period != 0 || !cycles->hash_is_stale) {
+        return;
+    }
+
+    // Edited generations can not be compared to the ones before them.
+    cycles->hash = simulation_hash(simulation);
+    cycles->hash_is_stale = false;
+    cycles->history[simulation->generation % CYCLE_HISTORY_SIZE] = cycles->hash;
+    cycles->history_length = 1;
+}
+
+/**
+*   Applies what the workers hashed to the hash of the new generation and looks it up in
+*   the history. Called after stepping.
+*
+*   The generations are checked one by one, so the first repeat is found as soon as the
+*   generation that closes it was stepped, and `cycle_start` is exactly where the cycle begins.
+*/
+void cycle_detector_end(Simulation *simulation) {
+    Cycle_Detector *cycles = simulation->cycles;
+    if (cycles == NULL || cycles->period != 0) {
+        return;
+    }
+
+    for (size_t idx = 0; idx < cycles->worker_count; idx++) {
+        cycles->hash ^= cycles->worker_hash_deltas[idx];
+        cycles->worker_hash_deltas[idx] = 0;
+    }
+
+    const uint64_t generation = simulation->generation;
+    for (uint64_t period = 1; period <= cycles->history_length; period++) {
+        if (cycles->history[(generation - period) % CYCLE_HISTORY_SIZE] == cycles->hash) {
+            cycles->period = period;
+            cycles->cycle_start = generation - period;
+            // No longer tracked, the generations after this one are all known.
+            cycles->hash_is_stale = true;
+            return;
+        }
+    }
+
+    cycles->history[generation % CYCLE_HISTORY_SIZE] = cycles->hash;
+    cycles->history_length = MIN(cycles->history_length + 1, CYCLE_HISTORY_SIZE);
+}
+
+// If a cycle was found and the simulation was asked to stop there.
+static inline bool simulation_stopped_at_cycle(const Simulation *simulation) {
+    return simulation->cycles != NULL
+        && simulation->cycles->period != 0
+        && simulation->cycles->action == CYCLE_ACTION_STOP;
+}
+
+void simulation_print_cycle(const Simulation *simulation) {
+    const Cycle_Detector *cycles = simulation->cycles;
+    if (cycles == NULL) {
+        return;
+    }
+
+    if (cycles->period == 0) {
+        printf("cycle:            none found\n");
+    } else
+    if (cycles->period == 1) {
+        printf("cycle:            stable since generation %" PRIu64 "\n", cycles->cycle_start);
+    } else {
+        printf("cycle:            period %" PRIu64 " since generation %" PRIu64 "\n", cycles->period, cycles->cycle_start);
+    }
+    if (cycles->skipped_generations > 0) {
+        printf("fast-forwarded:   %" PRIu64 " generations\n", cycles->skipped_generations);
+    }
+}
+
+/**
+*   Queues the current generation if it is due, which no step has done yet, waits for the
+*   writer to catch up and prints how many frames were written and dropped.
+*/
+void simulation_print_frames(Simulation *simulation) {
+    Frame_Writer *frames = simulation->frames;
+    if (frames == NULL) {
+        return;
+    }
+
+    simulation_dump_frame(simulation);
+    frame_writer_drain(frames);
+
+    printf("frames:           %" PRIu64 " written to %s", frames->written_count, frames->dir);
+    if (frames->failed_count > 0) {
+        printf(", %" PRIu64 " failed", frames->failed_count);
+    }
+    printf(", %" PRIu64 " dropped\n", frames->dropped_count);
+    printf(
+        "frame queue:      at most %zu of %d queued, waited %" PRIu64 " times for %.1f ms\n",
+        frames->max_queued, FRAME_QUEUE_SIZE, frames->wait_count, frames->wait_ns / 1e6
+    );
+}
+
+/**
+*   # Returns
+*
+*   The bounding box of the alive cells in the rows `[row_begin, row_end)` and columns
+*   `[col_begin, col_end)` of the back grid of the bool or bitpacked engine. The bitpacked
+*   engine looks at the whole words of those columns.
+*/
+Bounding_Box grid_bounding_box(
+    const Simulation *simulation,
+    const size_t row_begin, const size_t row_end,
+    const size_t col_begin, const size_t col_end
+) {
+    Bounding_Box box = BOUNDING_BOX_EMPTY;
+    for (size_t row = row_begin; row < row_end; row++) {
+        if (simulation->engine == ENGINE_BOOL) {
+            const bool *cells = cell_array_row(simulation->back, row);
+            if (memchr(&cells[col_begin], true, col_end - col_begin) != NULL) {
+                bounding_box_add_cells(&box, cells, row, col_begin, col_end);
+            }
+            continue;
+        }
+
+        bounding_box_add_words(
+            &box, bit_array_row(simulation->bits_back, row), row,
+            col_begin / BIT_ARRAY_WORD_BITS, (col_end + BIT_ARRAY_WORD_BITS - 1) / BIT_ARRAY_WORD_BITS
+        );
+    }
+    return box;
+}
+
+/**
+*   Writes the population, births, deaths, bounding box and step time of every generation
+*   from now on to `path` as CSV. Exits when it can not be opened.
+*/
+void simulation_write_metrics(Simulation *simulation, const char *path) {
+    const size_t worker_count = simulation->pool != NULL ? simulation->pool->worker_count : 1;
+
+    Metrics *metrics = calloc(1, sizeof(Metrics));
+    if (metrics == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the metrics!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    metrics->is_stale = true;
+    metrics->worker_count = worker_count;
+    metrics->worker_counts = calloc(worker_count, sizeof(Generation_Counts));
+    // Filled by the first step, which counts everything.
+    if (simulation->tiles_changed != NULL) {
+        metrics->tile_boxes = malloc(sizeof(Bounding_Box) * simulation->tile_rows * simulation->tile_cols);
+    }
+    if (metrics->worker_counts == NULL || (simulation->tiles_changed != NULL && metrics->tile_boxes == NULL)) {
+        PRINT_ERR_LOC("Failed allocating memory for the metrics!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    metrics_writer_open(&metrics->writer, path);
+    simulation->metrics = metrics;
+}
+
+// Recounts the population if cells were edited and starts timing the step. Called before stepping.
+void metrics_begin(Simulation *simulation) {
+    Metrics *metrics = simulation->metrics;
+    if (metrics == NULL) {
+        return;
+    }
+
+    if (metrics->is_stale) {
+        metrics->population = simulation_population(simulation);
+    }
+    metrics->step_start_ns = monotonic_ns();
+}
+
+/**
+*   Sums up what the workers counted, applies the births and deaths to the population and
+*   hands the record of the new generation to the writer. Called after stepping.
+*/
+void metrics_end(Simulation *simulation) {
+    Metrics *metrics = simulation->metrics;
+    if (metrics == NULL) {
+        return;
+    }
+
+    Metrics_Record record = {
+        .generation = simulation->generation,
+        .births = 0,
+        .deaths = 0,
+        .box = BOUNDING_BOX_EMPTY,
+        .step_ns = monotonic_ns() - metrics->step_start_ns,
+    };
+    for (size_t idx = 0; idx < metrics->worker_count; idx++) {
+        record.births += metrics->worker_counts[idx].births;
+        record.deaths += metrics->worker_counts[idx].deaths;
+        bounding_box_merge(&record.box, metrics->worker_counts[idx].box);
+    }
+    metrics->population += record.births - record.deaths;
+    metrics->is_stale = false;
+    record.population = metrics->population;
+
+    metrics_writer_push(&metrics->writer, record);
+}
+
+// Steps the rows `[row_begin, row_end)` of the bool or bitpacked grid and counts the changes
+// into `counts` unless it is NULL.
+static inline void step_grid_rows(Simulation *simulation, const size_t row_begin, const size_t row_end, Generation_Counts *counts) {
+    switch (simulation->engine) {
+        case ENGINE_BOOL:      cell_array_step(&simulation->front, simulation->back, row_begin, row_end, counts); break;
+        case ENGINE_BITPACKED: bit_array_step(simulation->bits_front, &simulation->bits_back, row_begin, row_end, simulation->wrap, counts); break;
+        case ENGINE_HASHLIFE:  break;
+        case ENGINE_SPARSE:    break;
+    }
+}
+
+// Steps one band of rows, the bands of all workers together cover the whole grid.
+void step_band(void *data, const size_t worker_idx, const size_t worker_count) {
+    Simulation *simulation = data;
+    const size_t row_begin = simulation->rows * worker_idx / worker_count;
+    const size_t row_end = simulation->rows * (worker_idx + 1) / worker_count;
+
+    // The counting kernels count the changes while stepping, the others leave them out entirely.
+    Generation_Counts counts = GENERATION_COUNTS_EMPTY;
+    step_grid_rows(simulation, row_begin, row_end, simulation->metrics != NULL ? &counts : NULL);
+    if (simulation->metrics != NULL) {
+        simulation->metrics->worker_counts[worker_idx] = counts;
+    }
+
+    if (simulation_tracks_hash(simulation)) {
+        simulation->cycles->worker_hash_deltas[worker_idx] = grid_hash_delta(simulation, row_begin, row_end, 0, simulation->cols);
+    }
+}
+
+// Steps one share of the chunks of the sparse universe.
+void step_sparse_band(void *data, const size_t worker_idx, const size_t worker_count) {
+    const Simulation *simulation = data;
+    const Sparse_Universe *sparse = simulation->sparse;
+    const size_t chunk_begin = sparse->chunk_count * worker_idx / worker_count;
+    const size_t chunk_end = sparse->chunk_count * (worker_idx + 1) / worker_count;
+    sparse_step_chunks(sparse, chunk_begin, chunk_end);
+
+    if (simulation_tracks_hash(simulation)) {
+        uint64_t hash = 0;
+        for (size_t idx = chunk_begin; idx < chunk_end; idx++) {
+            const Chunk *chunk = sparse->chunks[idx];
+            const uint64_t *old_words = chunk->cells[sparse->front];
+            const uint64_t *new_words = chunk->cells[1 - sparse->front];
+            for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+                if (old_words[cell_row] != new_words[cell_row]) {
+                    const int64_t row = chunk->chunk_row * CHUNK_SIZE + (int64_t)cell_row;
+                    hash ^= word_hash_change(old_words[cell_row], new_words[cell_row], row, chunk->chunk_col);
+                }
+            }
+        }
+        simulation->cycles->worker_hash_deltas[worker_idx] = hash;
+    }
+
+    if (simulation->metrics != NULL) {
+        Generation_Counts counts = GENERATION_COUNTS_EMPTY;
+        for (size_t idx = chunk_begin; idx < chunk_end; idx++) {
+            const Chunk *chunk = sparse->chunks[idx];
+            const uint64_t *new_words = chunk->cells[1 - sparse->front];
+            words_count_kernel(chunk->cells[sparse->front], new_words, CHUNK_SIZE, &counts);
+
+            // The columns of all rows OR-ed together give the columns of the bounding box.
+            uint64_t columns = 0;
+            size_t first_row = CHUNK_SIZE;
+            size_t last_row = 0;
+            for (size_t cell_row = 0; cell_row < CHUNK_SIZE; cell_row++) {
+                if (new_words[cell_row] != 0) {
+                    columns |= new_words[cell_row];
+                    first_row = MIN(first_row, cell_row);
+                    last_row = cell_row;
+                }
+            }
+            if (columns != 0) {
+                const int64_t row_offset = chunk->chunk_row * CHUNK_SIZE;
+                bounding_box_add_word(&counts.box, columns, row_offset + (int64_t)first_row, chunk->chunk_col * CHUNK_SIZE);
+                bounding_box_add_word(&counts.box, columns, row_offset + (int64_t)last_row, chunk->chunk_col * CHUNK_SIZE);
+            }
+        }
+        simulation->metrics->worker_counts[worker_idx] = counts;
+    }
+}
+
+/**
+*   # Returns
+*
+*   If the tile or one of its 8 neighbors changed in the last generation.
+*   Only those tiles can change in the next one.
+*/
+bool tile_is_active(const Simulation *simulation, const size_t tile_row, const size_t tile_col) {
+    const size_t tile_rows = simulation->tile_rows;
+    const size_t tile_cols = simulation->tile_cols;
+
+    // Neighbors are at offsets 0 to 2 from one before the tile. On a torus the tiles on the
+    // other edge are neighbors too, otherwise there is nothing outside of the grid.
+    for (size_t row_offset = 0; row_offset < 3; row_offset++) {
+        size_t row = tile_row + row_offset;
+        if (row == 0 || row > tile_rows) {
+            if (!simulation->wrap) {
+                continue;
+            }
+            row = row == 0 ? tile_rows : 1;
+        }
+        row--;
+
+        for (size_t col_offset = 0; col_offset < 3; col_offset++) {
+            size_t col = tile_col + col_offset;
+            if (col == 0 || col > tile_cols) {
+                if (!simulation->wrap) {
+                    continue;
+                }
+                col = col == 0 ? tile_cols : 1;
+            }
+            col--;
+
+            if (simulation->tiles_changed[row * tile_cols + col]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+*   Steps one band of tile rows, only computing the active tiles.
+*
+*   A tile that did not change in the last generation holds the same cells in `front` and
+*   `back`. If none of its neighbors changed either its next generation is those same cells,
+*   so skipping it leaves exactly the right cells in `back`.
+*/
+void step_tiles_band(void *data, const size_t worker_idx, const size_t worker_count) {
+    Simulation *simulation = data;
+    const size_t tile_row_begin = simulation->tile_rows * worker_idx / worker_count;
+    const size_t tile_row_end = simulation->tile_rows * (worker_idx + 1) / worker_count;
+
+    Metrics *metrics = simulation->metrics;
+    size_t active_tile_count = 0;
+    uint64_t hash_delta = 0;
+    Generation_Counts counts = GENERATION_COUNTS_EMPTY;
+    for (size_t tile_row = tile_row_begin; tile_row < tile_row_end; tile_row++) {
+        const size_t row_begin = tile_row * TILE_SIZE;
+        const size_t row_end = MIN(row_begin + TILE_SIZE, simulation->rows);
+
+        for (size_t tile_col = 0; tile_col < simulation->tile_cols; tile_col++) {
+            const size_t tile_idx = tile_row * simulation->tile_cols + tile_col;
+            const size_t col_begin = tile_col * TILE_SIZE;
+            const size_t col_end = MIN(col_begin + TILE_SIZE, simulation->cols);
+            if (!tile_is_active(simulation, tile_row, tile_col)) {
+                simulation->tiles_changed_next[tile_idx] = false;
+                // After an edit no bounding box can be trusted. Nothing was born or died here,
+                // so the box is all that is missing.
+                if (metrics != NULL && metrics->is_stale) {
+                    metrics->tile_boxes[tile_idx] = grid_bounding_box(simulation, row_begin, row_end, col_begin, col_end);
+                }
+                continue;
+            }
+            active_tile_count++;
+
+            // The box of the tile is kept for the generations it does not change in.
+            Generation_Counts tile_counts = GENERATION_COUNTS_EMPTY;
+            Generation_Counts *step_counts = metrics != NULL ? &tile_counts : NULL;
+            bool changed = false;
+            switch (simulation->engine) {
+            case ENGINE_BOOL: {
+                for (size_t row = row_begin; row < row_end; row++) {
+                    cell_array_step_row(&simulation->front, simulation->back, row, col_begin, col_end, step_counts);
+                    changed |= memcmp(
+                        &cell_array_row(simulation->back, row)[col_begin],
+                        &cell_array_row(simulation->front, row)[col_begin],
+                        col_end - col_begin
+                    ) != 0;
+                }
+                break;
+            }
+
+            case ENGINE_BITPACKED: {
+                for (size_t row = row_begin; row < row_end; row++) {
+                    bit_array_step_row(
+                        simulation->bits_front, &simulation->bits_back, row, tile_col, tile_col + 1, simulation->wrap, step_counts
+                    );
+                    changed |= bit_array_row(simulation->bits_back, row)[tile_col]
+                            != bit_array_row(simulation->bits_front, row)[tile_col];
+                }
+                break;
+            }
+
+            case ENGINE_HASHLIFE: break;
+            case ENGINE_SPARSE:   break;
+            }
+
+            simulation->tiles_changed_next[tile_idx] = changed;
+            if (changed && simulation_tracks_hash(simulation)) {
+                hash_delta ^= grid_hash_delta(simulation, row_begin, row_end, col_begin, col_end);
+            }
+            if (metrics != NULL) {
+                counts.births += tile_counts.births;
+                counts.deaths += tile_counts.deaths;
+                metrics->tile_boxes[tile_idx] = tile_counts.box;
+            }
+        }
+
+        if (metrics != NULL) {
+            for (size_t tile_col = 0; tile_col < simulation->tile_cols; tile_col++) {
+                bounding_box_merge(&counts.box, metrics->tile_boxes[tile_row * simulation->tile_cols + tile_col]);
+            }
+        }
+    }
+
+    simulation->worker_active_tile_counts[worker_idx] = active_tile_count;
+    if (metrics != NULL) {
+        metrics->worker_counts[worker_idx] = counts;
+    }
+    if (simulation_tracks_hash(simulation)) {
+        simulation->cycles->worker_hash_deltas[worker_idx] = hash_delta;
+    }
+}
+
+// Steps the bool or bitpacked grid, on the worker pool if there is one.
+void step_grid(Simulation *simulation) {
+    // The bool engine reads the other edges of a torus from the ghost border of the grid.
+    if (simulation->engine == ENGINE_BOOL && simulation->wrap) {
+        cell_array_fill_halo(simulation->front);
+    }
+
+    const Worker_Job job = simulation->tiles_changed != NULL ? step_tiles_band : step_band;
+    if (simulation->pool != NULL) {
+        worker_pool_run(simulation->pool, job, simulation);
+    } else {
+        job(simulation, 0, 1);
+    }
+
+    if (simulation->tiles_changed != NULL) {
+        bool *tiles_changed = simulation->tiles_changed;
+        simulation->tiles_changed = simulation->tiles_changed_next;
+        simulation->tiles_changed_next = tiles_changed;
+
+        const size_t worker_count = simulation->pool != NULL ? simulation->pool->worker_count : 1;
+        simulation->active_tile_count = 0;
+        for (size_t idx = 0; idx < worker_count; idx++) {
+            simulation->active_tile_count += simulation->worker_active_tile_counts[idx];
+        }
+    }
+
+    switch (simulation->engine) {
+    case ENGINE_BOOL: {
+        const Cell_Array_2d old_grid = simulation->front;
+        simulation->front = simulation->back;
+        simulation->back = old_grid;
+        break;
+    }
+
+    case ENGINE_BITPACKED: {
+        const Bit_Array_2d old_grid = simulation->bits_front;
+        simulation->bits_front = simulation->bits_back;
+        simulation->bits_back = old_grid;
+        simulation->front_is_stale = true;
+        break;
+    }
+
+    case ENGINE_HASHLIFE: break;
+    case ENGINE_SPARSE:   break;
+    }
+}
+
+void step(Simulation *simulation) {
+    // Before stepping, so edits since the last step and the first generation end up in a frame too.
+    simulation_dump_frame(simulation);
+
+    STATS_BEGIN(STATS_PHASE_STEP);
+    const uint64_t allocation_count = atomic_load_explicit(&engine_allocation_count, memory_order_relaxed);
+    cycle_detector_begin(simulation);
+    metrics_begin(simulation);
+
+    switch (simulation->engine) {
+    case ENGINE_BOOL:
+    case ENGINE_BITPACKED: {
+        step_grid(simulation);
+        break;
+    }
+
+    case ENGINE_HASHLIFE: {
+        hashlife_advance_pow2(simulation->hashlife, 0);
+        simulation->front_is_stale = true;
+        break;
+    }
+
+    case ENGINE_SPARSE: {
+        sparse_create_neighbors(simulation->sparse);
+        if (simulation->pool != NULL) {
+            worker_pool_run(simulation->pool, step_sparse_band, simulation);
+        } else {
+            step_sparse_band(simulation, 0, 1);
+        }
+        sparse_finish_step(simulation->sparse);
+        simulation->front_is_stale = true;
+        break;
+    }
+    }
+
+    simulation->generation++;
+    metrics_end(simulation);
+    cycle_detector_end(simulation);
+    STATS_END(STATS_PHASE_STEP);
+    stats_record_generations(1, atomic_load_explicit(&engine_allocation_count, memory_order_relaxed) - allocation_count);
+
+    simulation_checkpoint(simulation);
+    stats_poll_report(simulation);
+}
+
+/**
+*   Advances the simulation by `generations` generations.
+*   Hashlife jumps there in steps of powers of 2, the other engines step one by one.
+*/
+void simulation_advance(Simulation *simulation, const uint64_t generations) {
+    if (simulation->engine == ENGINE_HASHLIFE) {
+        uint64_t remaining = generations;
+        while (remaining > 0 && running) {
+            simulation_dump_frame(simulation);
+
+            // Stop at every frame on the way.
+            uint64_t jump = remaining;
+            if (simulation->frames != NULL) {
+                jump = MIN(jump, simulation->frames->every - simulation->generation % simulation->frames->every);
+            }
+
+            STATS_BEGIN(STATS_PHASE_STEP);
+            const uint64_t allocation_count = atomic_load_explicit(&engine_allocation_count, memory_order_relaxed);
+            hashlife_advance(simulation->hashlife, jump);
+            STATS_END(STATS_PHASE_STEP);
+            stats_record_generations(jump, atomic_load_explicit(&engine_allocation_count, memory_order_relaxed) - allocation_count);
+
+            simulation->front_is_stale = true;
+            simulation->generation += jump;
+            remaining -= jump;
+            stats_poll_report(simulation);
+        }
+        return;
+    }
+
+    for (uint64_t generation = 0; generation < generations && running; generation++) {
+        step(simulation);
+
+        const Cycle_Detector *cycles = simulation->cycles;
+        if (cycles == NULL || cycles->period == 0) {
+            continue;
+        }
+        if (cycles->action == CYCLE_ACTION_STOP) {
+            break;
+        }
+        // Whole periods end up at the generation they started from, so they can be skipped.
+        const uint64_t remaining = generations - generation - 1;
+        const uint64_t skipped = remaining - remaining % cycles->period;
+        simulation->cycles->skipped_generations += skipped;
+        simulation->generation += skipped;
+        generation += skipped;
+    }
+}
+
+/**
+*  Runs something at a fixed rate, like simulation updates or frames, by sleeping until
+*  absolute `CLOCK_MONOTONIC` deadlines, so neither sleeping too long nor the work itself
+*  makes the rate drift.
+*
+*  When running late the ticks that were missed are either caught up, up to
+*  `SCHEDULER_MAX_CATCH_UP` at once, or dropped. Either way the deadline then moves on
+*  from now, so a long stall never turns into a burst of ticks.
+*/
+typedef struct {
+    // 0 runs as fast as possible.
+    uint64_t period_ns;
+    bool catch_up;
+    uint64_t deadline_ns;
+    uint64_t dropped_ticks;
+} Scheduler;
+
+#define SCHEDULER_MAX_CATCH_UP 8
+// A day, slower rates are clamped to it so deadlines can not overflow.
+#define SCHEDULER_MAX_PERIOD_NS (UINT64_C(86400) * 1000000000)
+// Longest single sleep, how long quitting can take at most.
+#define SCHEDULER_SLICE_NS 20000000
+
+/**
+*   `rate` is in ticks per second, 0 for unlimited.
+*/
+Scheduler scheduler_init(const double rate, const bool catch_up) {
+    return (Scheduler){
+        .period_ns = rate > 0 ? MIN(1e9 / rate, SCHEDULER_MAX_PERIOD_NS) : 0,
+        .catch_up = catch_up,
+        .deadline_ns = monotonic_ns(),
+        .dropped_ticks = 0,
+    };
+}
+
+static inline struct timespec timespec_from_ns(const uint64_t ns) {
+    return (struct timespec){ .tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000 };
+}
+
+/**
+*   Sleeps until the next tick is due.
+*
+*   The sleep is split into slices of at most `SCHEDULER_SLICE_NS`, after each one `running` and
+*   `stop` are checked again, so quitting never waits for a long period to run out.
+*   `stop` can be NULL.
+*
+*   # Returns
+*
+*   How many ticks to run now, more than 1 when catching up, 0 when it was stopped early.
+*/
+uint64_t scheduler_wait(Scheduler *scheduler, _Atomic bool *stop) {
+    if (scheduler->period_ns == 0) {
+        return 1;
+    }
+
+    scheduler->deadline_ns += scheduler->period_ns;
+    for (;;) {
+        if (!running || (stop != NULL && atomic_load_explicit(stop, memory_order_relaxed))) {
+            return 0;
+        }
+
+        const uint64_t slice_start_ns = monotonic_ns();
+        if (slice_start_ns >= scheduler->deadline_ns) {
+            break;
+        }
+        const struct timespec slice_end =
+            timespec_from_ns(MIN(scheduler->deadline_ns, slice_start_ns + SCHEDULER_SLICE_NS));
+        // Signals wake it up early, the next slice goes on from where it stopped.
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &slice_end, NULL);
+    }
+
+    const uint64_t now_ns = monotonic_ns();
+    if (now_ns < scheduler->deadline_ns + scheduler->period_ns) {
+        return 1;
+    }
+
+    // Late by at least a whole tick
+    const uint64_t missed_ticks = (now_ns - scheduler->deadline_ns) / scheduler->period_ns;
+    const uint64_t caught_up_ticks = scheduler->catch_up ? MIN(missed_ticks, SCHEDULER_MAX_CATCH_UP) : 0;
+    scheduler->dropped_ticks += missed_ticks - caught_up_ticks;
+    scheduler->deadline_ns = now_ns;
+    return 1 + caught_up_ticks;
+}
+
+// Enough for grids up to 2^32 cells wide.
+#define DENSITY_MAX_LEVELS 32
+/**
+*  Population counts of square blocks of a grid, for drawing grids that are zoomed out
+*  further than one cell per pixel.
+*
+*  Level `k` counts the alive cells of blocks of 2^k by 2^k cells, `counts[k - 1]` holds it
+*  with `rows[k - 1]` by `cols[k - 1]` blocks. Every level is built from the one below, so
+*  building all of them costs about a third more than building the first one.
+*/
+typedef struct {
+    uint32_t *counts[DENSITY_MAX_LEVELS];
+    size_t rows[DENSITY_MAX_LEVELS];
+    size_t cols[DENSITY_MAX_LEVELS];
+    size_t level_count;
+} Density_Pyramid;
+
+Density_Pyramid density_pyramid_init(const size_t rows, const size_t cols) {
+    Density_Pyramid pyramid = { .level_count = 0 };
+
+    size_t level_rows = rows;
+    size_t level_cols = cols;
+    // Up to the level that is a single block.
+    while ((level_rows > 1 || level_cols > 1) && pyramid.level_count < DENSITY_MAX_LEVELS) {
+        level_rows = (level_rows + 1) / 2;
+        level_cols = (level_cols + 1) / 2;
+
+        pyramid.counts[pyramid.level_count] = malloc(sizeof(uint32_t) * level_rows * level_cols);
+        if (pyramid.counts[pyramid.level_count] == NULL) {
+            PRINT_ERR_LOC("Failed allocating memory for the density levels!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+        pyramid.rows[pyramid.level_count] = level_rows;
+        pyramid.cols[pyramid.level_count] = level_cols;
+        pyramid.level_count++;
+    }
+
+    return pyramid;
+}
+
+void density_pyramid_free(Density_Pyramid *pyramid) {
+    for (size_t level = 0; level < pyramid->level_count; level++) {
+        free(pyramid->counts[level]);
+        pyramid->counts[level] = NULL;
+    }
+    pyramid->level_count = 0;
+}
+
+void density_pyramid_build(Density_Pyramid *pyramid, const Cell_Array_2d grid) {
+    if (pyramid->level_count == 0) {
+        return;
+    }
+
+    // Level 1 from the cells
+    for (size_t block_row = 0; block_row < pyramid->rows[0]; block_row++) {
+        const bool *top = cell_array_row(grid, block_row * 2);
+        const bool *bottom = block_row * 2 + 1 < grid.rows ? cell_array_row(grid, block_row * 2 + 1) : NULL;
+        uint32_t *counts = &pyramid->counts[0][block_row * pyramid->cols[0]];
+
+        for (size_t block_col = 0; block_col < pyramid->cols[0]; block_col++) {
+            const size_t col = block_col * 2;
+            const bool has_right = col + 1 < grid.cols;
+            uint32_t count = top[col] + (has_right ? top[col + 1] : 0);
+            if (bottom != NULL) {
+                count += bottom[col] + (has_right ? bottom[col + 1] : 0);
+            }
+            counts[block_col] = count;
+        }
+    }
+
+    // Every other level from the one below
+    for (size_t level = 1; level < pyramid->level_count; level++) {
+        const uint32_t *below = pyramid->counts[level - 1];
+        const size_t below_rows = pyramid->rows[level - 1];
+        const size_t below_cols = pyramid->cols[level - 1];
+
+        for (size_t block_row = 0; block_row < pyramid->rows[level]; block_row++) {
+            const uint32_t *top = &below[block_row * 2 * below_cols];
+            const uint32_t *bottom = block_row * 2 + 1 < below_rows ? top + below_cols : NULL;
+            uint32_t *counts = &pyramid->counts[level][block_row * pyramid->cols[level]];
+
+            for (size_t block_col = 0; block_col < pyramid->cols[level]; block_col++) {
+                const size_t col = block_col * 2;
+                const bool has_right = col + 1 < below_cols;
+                uint32_t count = top[col] + (has_right ? top[col + 1] : 0);
+                if (bottom != NULL) {
+                    count += bottom[col] + (has_right ? bottom[col + 1] : 0);
+                }
+                counts[block_col] = count;
+            }
+        }
+    }
+}
+
+/**
+*  Steps a simulation on its own thread and hands finished generations to the renderer
+*  through a lock free triple buffer.
+*
+*  Of the 3 grids in `grids` the simulation thread writes into `write_idx` and the renderer
+*  reads `read_idx`. The third one is in `middle`. Publishing swaps the written grid into
+*  `middle` and sets `TRIPLE_BUFFER_FRESH`, and the renderer swaps it out once it sees that
+*  bit. Neither side ever waits for the other or sees a half written grid.
+*
+*  The simulation must not be touched by other threads between `simulation_thread_start`
+*  and `simulation_thread_stop`.
+*/
+typedef struct {
+    Simulation *simulation;
+    pthread_t thread;
+
+    Cell_Array_2d grids[3];
+    // Built with every grid when `with_density` is set.
+    Density_Pyramid densities[3];
+    bool with_density;
+    _Atomic uint8_t middle;
+    uint8_t write_idx;
+    uint8_t read_idx;
+
+    // Generations per second, 0 for as fast as possible.
+    double target_ups;
+    // When stepping manually the thread only steps when the renderer asks for it.
+    bool step_manually;
+    _Atomic uint64_t requested_steps;
+    _Atomic bool stop;
+    // Generations the thread fell too far behind on to catch up, valid after it stopped.
+    uint64_t dropped_steps;
+} Simulation_Thread;
+
+#define TRIPLE_BUFFER_FRESH 0x4
+#define TRIPLE_BUFFER_INDEX_MASK 0x3
+
+// How long the thread sleeps while waiting for a manual step.
+#define SIMULATION_THREAD_IDLE_NS 1000000
+
+/**
+*   Copies the current generation into `grid`, which has the size of the simulation.
+*/
+void simulation_write_grid(Simulation *simulation, Cell_Array_2d *grid) {
+    switch (simulation->engine) {
+        case ENGINE_BOOL:      memcpy(grid->cells, simulation->front.cells, grid->rows * grid->stride); break;
+        case ENGINE_BITPACKED: bit_array_unpack(grid, simulation->bits_front); break;
+        case ENGINE_HASHLIFE:  hashlife_write_cells(simulation->hashlife, grid); break;
+        case ENGINE_SPARSE:    sparse_write_cells(simulation->sparse, grid); break;
+    }
+}
+
+static void simulation_thread_publish(Simulation_Thread *simulation_thread) {
+    STATS_BEGIN(STATS_PHASE_PUBLISH);
+    Cell_Array_2d *grid = &simulation_thread->grids[simulation_thread->write_idx];
+    simulation_write_grid(simulation_thread->simulation, grid);
+    if (simulation_thread->with_density) {
+        density_pyramid_build(&simulation_thread->densities[simulation_thread->write_idx], *grid);
+    }
+
+    const uint8_t old_middle = atomic_exchange_explicit(
+        &simulation_thread->middle,
+        simulation_thread->write_idx | TRIPLE_BUFFER_FRESH,
+        memory_order_acq_rel
+    );
+    simulation_thread->write_idx = old_middle & TRIPLE_BUFFER_INDEX_MASK;
+    STATS_END(STATS_PHASE_PUBLISH);
+}
+
+static void *simulation_thread_main(void *args) {
+    Simulation_Thread *simulation_thread = args;
+    // Steps that were missed are caught up so the simulation keeps its rate.
+    Scheduler scheduler = scheduler_init(simulation_thread->target_ups, true);
+
+    while (running && !atomic_load_explicit(&simulation_thread->stop, memory_order_relaxed)) {
+        uint64_t steps = 1;
+        if (simulation_thread->step_manually) {
+            if (atomic_load_explicit(&simulation_thread->requested_steps, memory_order_acquire) == 0) {
+                const struct timespec idle = { .tv_sec = 0, .tv_nsec = SIMULATION_THREAD_IDLE_NS };
+                nanosleep(&idle, NULL);
+                continue;
+            }
+            atomic_fetch_sub_explicit(&simulation_thread->requested_steps, 1, memory_order_acq_rel);
+        } else {
+            // Nothing changes anymore, the renderer keeps showing the last generation.
+            if (simulation_stopped_at_cycle(simulation_thread->simulation)) {
+                break;
+            }
+            steps = scheduler_wait(&scheduler, &simulation_thread->stop);
+            if (steps == 0) {
+                break;
+            }
+        }
+
+        // Only the last generation is published, the renderer could not show the others anyway.
+        // Manual steps past a cycle that stopped the simulation publish the same generation again.
+        for (uint64_t step_idx = 0; step_idx < steps && running; step_idx++) {
+            if (simulation_stopped_at_cycle(simulation_thread->simulation)) {
+                break;
+            }
+            step(simulation_thread->simulation);
+        }
+        simulation_thread_publish(simulation_thread);
+    }
+
+    simulation_thread->dropped_steps = scheduler.dropped_ticks;
+    return NULL;
+}
+
+/**
+*   Starts stepping `simulation` on a new thread, until `simulation_thread_stop` or CTRL+C.
+*/
+void simulation_thread_start(
+    Simulation_Thread *simulation_thread,
+    Simulation *simulation,
+    const double target_ups,
+    const bool step_manually,
+    const bool with_density
+) {
+    *simulation_thread = (Simulation_Thread){
+        .simulation = simulation,
+        .with_density = with_density,
+        .write_idx = 0,
+        .read_idx = 1,
+        .target_ups = target_ups,
+        .step_manually = step_manually,
+    };
+    atomic_init(&simulation_thread->middle, 2);
+    atomic_init(&simulation_thread->requested_steps, 0);
+    atomic_init(&simulation_thread->stop, false);
+
+    // The renderer can show the current generation until the first one is published.
+    for (size_t grid_idx = 0; grid_idx < ARR_LEN(simulation_thread->grids); grid_idx++) {
+        simulation_thread->grids[grid_idx] = cell_array_init(simulation->rows, simulation->cols);
+        simulation_write_grid(simulation, &simulation_thread->grids[grid_idx]);
+        if (with_density) {
+            simulation_thread->densities[grid_idx] = density_pyramid_init(simulation->rows, simulation->cols);
+            density_pyramid_build(&simulation_thread->densities[grid_idx], simulation_thread->grids[grid_idx]);
+        }
+    }
+
+    if (pthread_create(&simulation_thread->thread, NULL, simulation_thread_main, simulation_thread) != 0) {
+        PRINT_ERR("Failed creating the simulation thread!\n");
+        exit(EX_THREAD_ERROR);
+    }
+}
+
+void simulation_thread_stop(Simulation_Thread *simulation_thread) {
+    atomic_store_explicit(&simulation_thread->stop, true, memory_order_relaxed);
+    pthread_join(simulation_thread->thread, NULL);
+
+    for (size_t grid_idx = 0; grid_idx < ARR_LEN(simulation_thread->grids); grid_idx++) {
+        cell_array_free_ptr(&simulation_thread->grids[grid_idx]);
+        density_pyramid_free(&simulation_thread->densities[grid_idx]);
+    }
+}
+
+/**
+*   Asks a manually stepped simulation thread for one more generation.
+*/
+void simulation_thread_request_step(Simulation_Thread *simulation_thread) {
+    atomic_fetch_add_explicit(&simulation_thread->requested_steps, 1, memory_order_acq_rel);
+}
+
+/**
+*   Takes the latest published generation, if there is a new one.
+*
+*   # Returns
+*
+*   If the grid changed since the last call.
+*/
+bool simulation_thread_poll(Simulation_Thread *simulation_thread) {
+    if ((atomic_load_explicit(&simulation_thread->middle, memory_order_acquire) & TRIPLE_BUFFER_FRESH) == 0) {
+        return false;
+    }
+
+    const uint8_t old_middle = atomic_exchange_explicit(&simulation_thread->middle, simulation_thread->read_idx, memory_order_acq_rel);
+    simulation_thread->read_idx = old_middle & TRIPLE_BUFFER_INDEX_MASK;
+    return true;
+}
+
+// The grid the renderer should show, see `simulation_thread_poll`.
+static inline Cell_Array_2d simulation_thread_grid(const Simulation_Thread *simulation_thread) {
+    return simulation_thread->grids[simulation_thread->read_idx];
+}
+
+// The density levels of `simulation_thread_grid`, only built when started `with_density`.
+static inline const Density_Pyramid *simulation_thread_density(const Simulation_Thread *simulation_thread) {
+    return &simulation_thread->densities[simulation_thread->read_idx];
+}
+
+typedef enum {
+    RENDER_MODE_CELLS      = 0,
+    RENDER_MODE_DENSE      = 1,
+    RENDER_MODE_HALF_BLOCK = 2,
+} Render_Mode;
+#define RENDER_MODE_COUNT ((RENDER_MODE_HALF_BLOCK - RENDER_MODE_CELLS) + 1)
+
+const char *render_mode_to_string(const Render_Mode render_mode) {
+    switch (render_mode) {
+        case RENDER_MODE_CELLS:      return "cells";
+        case RENDER_MODE_DENSE:      return "dense";
+        case RENDER_MODE_HALF_BLOCK: return "half-block";
+    }
+    return "";
+}
+
+/**
+*  Draws frames to the terminal. A frame is built in `buffer`, which is reused between
+*  frames, and reaches the terminal with a single `write`.
+*
+*  Every glyph on screen shows 1 cell, or with `RENDER_MODE_DENSE` 2x4 and with
+*  `RENDER_MODE_HALF_BLOCK` 1x2 cells. `previous` holds the code of every glyph on screen,
+*  so after the first frame only the glyphs that changed are emitted, with cursor moves
+*  to jump over the ones that did not.
+*/
+typedef struct {
+    Render_Mode mode;
+
+    char *buffer;
+    size_t length;
+    size_t capacity;
+
+    // Screen size in glyphs.
+    uint8_t *previous;
+    uint8_t *codes;
+    size_t rows;
+    size_t cols;
+    // Forces the next frame to redraw the whole screen, like after other output.
+    bool is_stale;
+
+    size_t last_frame_bytes;
+    uint64_t total_bytes;
+    uint64_t frame_count;
+} Terminal_Renderer;
+
+// Grid rows are drawn below the 2 header lines, terminal rows and cols start at 1.
+#define TERMINAL_GRID_FIRST_ROW 3
+// Reprinting up to this many bytes of unchanged glyphs is shorter than a cursor move over them.
+#define TERMINAL_MAX_REPRINT_BYTES 6
+
+Terminal_Renderer terminal_renderer_init(const Render_Mode mode) {
+    return (Terminal_Renderer){
+        .mode = mode,
+        .buffer = NULL,
+        .length = 0,
+        .capacity = 0,
+        .previous = NULL,
+        .codes = NULL,
+        .rows = 0,
+        .cols = 0,
+        .is_stale = true,
+        .last_frame_bytes = 0,
+        .total_bytes = 0,
+        .frame_count = 0,
+    };
+}
+
+void terminal_renderer_free(Terminal_Renderer *renderer) {
+    free(renderer->buffer);
+    free(renderer->previous);
+    free(renderer->codes);
+    renderer->buffer = NULL;
+    renderer->previous = NULL;
+    renderer->codes = NULL;
+}
+
+static void terminal_renderer_reserve(Terminal_Renderer *renderer, const size_t extra) {
+    if (renderer->length + extra <= renderer->capacity) {
+        return;
+    }
+
+    size_t capacity = MAX(renderer->capacity, 4096);
+    while (capacity < renderer->length + extra) {
+        capacity *= 2;
+    }
+    renderer->buffer = realloc(renderer->buffer, capacity);
+    if (renderer->buffer == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the terminal frame!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+    renderer->capacity = capacity;
+}
+
+static inline void terminal_renderer_append(Terminal_Renderer *renderer, const char *data, const size_t length) {
+    terminal_renderer_reserve(renderer, length);
+    memcpy(&renderer->buffer[renderer->length], data, length);
+    renderer->length += length;
+}
+
+#define TERMINAL_RENDERER_APPEND_LITERAL(renderer, literal) \
+    terminal_renderer_append((renderer), (literal), sizeof(literal) - 1)
+
+static void terminal_renderer_append_format(Terminal_Renderer *renderer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    const int length = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+
+    terminal_renderer_reserve(renderer, length + 1);
+    vsnprintf(&renderer->buffer[renderer->length], length + 1, format, args);
+    renderer->length += length;
+    va_end(args);
+}
+
+// Same as `cursor_move`, but into the frame.
+static inline void terminal_renderer_cursor_move(Terminal_Renderer *renderer, const size_t x, const size_t y) {
+    terminal_renderer_append_format(renderer, "\x1B[%zu;%zuH", y, x);
+}
+
+/**
+*   Writes the frame to stdout and empties the buffer.
+*/
+static void terminal_renderer_flush(Terminal_Renderer *renderer) {
+    // Output that went through stdio has to come first.
+    fflush(stdout);
+
+    size_t written = 0;
+    while (written < renderer->length) {
+        // Only loops when the terminal does not take the whole frame at once.
+        const ssize_t result = write(STDOUT_FILENO, &renderer->buffer[written], renderer->length - written);
+        if (result < 0) {
+            break;
+        }
+        written += result;
+    }
+
+    renderer->last_frame_bytes = renderer->length;
+    renderer->total_bytes += renderer->length;
+    renderer->frame_count++;
+    renderer->length = 0;
+}
+
+// The dense modes work on 8 cells at a time: a `uint64_t` loaded from the cell buffer holds
+// 8 bools, one per byte, that are shifted into place within 8 or 16 bit lanes.
+static inline uint64_t load_8_cells(const bool *cells) {
+    uint64_t word = 0;
+    memcpy(&word, cells, sizeof(word));
+    return word;
+}
+
+// Bools of the even and odd columns of 8 cells, in the low byte of 16 bit lanes.
+#define EVEN_CELLS(word) ((word) & UINT64_C(0x00FF00FF00FF00FF))
+#define ODD_CELLS(word) (((word) >> 8) & UINT64_C(0x00FF00FF00FF00FF))
+
+/**
+*   Braille glyphs of 2x4 cells for the screen row that starts at grid row `row`.
+*   Bit `n` of a code is dot `n + 1` of the braille pattern, see https://en.wikipedia.org/wiki/Braille_Patterns
+*/
+static void encode_braille_row(const Cell_Array_2d grid, const size_t row, uint8_t *codes, const size_t screen_cols) {
+    const bool *rows[4] = {0};
+    for (size_t row_offset = 0; row_offset < 4; row_offset++) {
+        rows[row_offset] = row + row_offset < grid.rows ? cell_array_row(grid, row + row_offset) : NULL;
+    }
+
+    // Dots 1, 2, 3, 7 are the left column from top to bottom, dots 4, 5, 6, 8 the right one.
+    static const uint8_t left_bits[4] = {0, 1, 2, 6};
+    static const uint8_t right_bits[4] = {3, 4, 5, 7};
+
+    size_t screen_col = 0;
+    for (; (screen_col + 4) * 2 <= grid.cols; screen_col += 4) {
+        uint64_t lanes = 0;
+        for (size_t row_offset = 0; row_offset < 4; row_offset++) {
+            if (rows[row_offset] == NULL) {
+                continue;
+            }
+            const uint64_t word = load_8_cells(&rows[row_offset][screen_col * 2]);
+            lanes |= EVEN_CELLS(word) << left_bits[row_offset];
+            lanes |= ODD_CELLS(word) << right_bits[row_offset];
+        }
+        for (size_t lane = 0; lane < 4; lane++) {
+            codes[screen_col + lane] = lanes >> (lane * 16);
+        }
+    }
+
+    for (; screen_col < screen_cols; screen_col++) {
+        uint8_t code = 0;
+        for (size_t row_offset = 0; row_offset < 4; row_offset++) {
+            if (rows[row_offset] == NULL) {
+                continue;
+            }
+            const size_t col = screen_col * 2;
+            code |= rows[row_offset][col] << left_bits[row_offset];
+            if (col + 1 < grid.cols) {
+                code |= rows[row_offset][col + 1] << right_bits[row_offset];
+            }
+        }
+        codes[screen_col] = code;
+    }
+}
+
+/**
+*   Half block glyphs of 1x2 cells for the screen row that starts at grid row `row`.
+*   Bit 0 of a code is the top cell and bit 1 the bottom one.
+*/
+static void encode_half_block_row(const Cell_Array_2d grid, const size_t row, uint8_t *codes) {
+    const bool *top = cell_array_row(grid, row);
+    const bool *bottom = row + 1 < grid.rows ? cell_array_row(grid, row + 1) : NULL;
+
+    size_t col = 0;
+    for (; col + 8 <= grid.cols; col += 8) {
+        uint64_t lanes = load_8_cells(&top[col]);
+        if (bottom != NULL) {
+            lanes |= load_8_cells(&bottom[col]) << 1;
+        }
+        memcpy(&codes[col], &lanes, sizeof(lanes));
+    }
+
+    for (; col < grid.cols; col++) {
+        codes[col] = top[col] | (bottom != NULL ? bottom[col] << 1 : 0);
+    }
+}
+
+#undef EVEN_CELLS
+#undef ODD_CELLS
+
+/**
+*   Encodes the glyphs of one screen row into `codes` for every render mode. A code says
+*   which cells of a glyph are alive, `terminal_renderer_append_glyph` turns it into text.
+*/
+static void encode_screen_row(const Terminal_Renderer *renderer, const Cell_Array_2d grid, const size_t screen_row, uint8_t *codes) {
+    switch (renderer->mode) {
+    case RENDER_MODE_CELLS: {
+        memcpy(codes, cell_array_row(grid, screen_row), grid.cols);
+        break;
+    }
+
+    case RENDER_MODE_DENSE: {
+        encode_braille_row(grid, screen_row * 4, codes, renderer->cols);
+        break;
+    }
+
+    case RENDER_MODE_HALF_BLOCK: {
+        encode_half_block_row(grid, screen_row * 2, codes);
+        break;
+    }
+    }
+}
+
+static inline void terminal_renderer_append_glyph(Terminal_Renderer *renderer, const uint8_t code, const char empty_cell) {
+    switch (renderer->mode) {
+    case RENDER_MODE_CELLS: {
+        const char cell = code ? 'X' : empty_cell;
+        terminal_renderer_append(renderer, &cell, 1);
+        break;
+    }
+
+    case RENDER_MODE_DENSE: {
+        // UTF-8 of U+2800 + code
+        const char glyph[3] = { (char)0xE2, (char)(0xA0 | (code >> 6)), (char)(0x80 | (code & 0x3F)) };
+        terminal_renderer_append(renderer, glyph, sizeof(glyph));
+        break;
+    }
+
+    case RENDER_MODE_HALF_BLOCK: {
+        static const char *glyphs[4] = { " ", "▀", "▄", "█" };
+        terminal_renderer_append(renderer, glyphs[code], strlen(glyphs[code]));
+        break;
+    }
+    }
+}
+
+void render_terminal(Terminal_Renderer *renderer, const Cell_Array_2d grid, const Color_Scheme color_scheme) {
+    STATS_BEGIN(STATS_PHASE_RENDER);
+    char empty_cell = '.';
+    switch (color_scheme) {
+        case COLOR_SCHEME_DEFAULT: empty_cell = '.'; break;
+        case COLOR_SCHEME_HACKER:  empty_cell = ' '; break;
+    }
+
+    size_t screen_rows = grid.rows;
+    size_t screen_cols = grid.cols;
+    size_t glyph_bytes = 1;
+    switch (renderer->mode) {
+        case RENDER_MODE_CELLS:      break;
+        case RENDER_MODE_DENSE:      screen_rows = (grid.rows + 3) / 4; screen_cols = (grid.cols + 1) / 2; glyph_bytes = 3; break;
+        case RENDER_MODE_HALF_BLOCK: screen_rows = (grid.rows + 1) / 2; glyph_bytes = 3; break;
+    }
+
+    if (renderer->rows != screen_rows || renderer->cols != screen_cols) {
+        free(renderer->previous);
+        free(renderer->codes);
+        renderer->previous = malloc(MAX(screen_rows * screen_cols, 1));
+        // Padded so the 8 byte stores of the last cells of a row stay inside.
+        renderer->codes = malloc(screen_cols + sizeof(uint64_t));
+        if (renderer->previous == NULL || renderer->codes == NULL) {
+            PRINT_ERR_LOC("Failed allocating memory for the previous terminal frame!\n");
+            exit(EX_MEMORY_ALLOCATION);
+        }
+        renderer->rows = screen_rows;
+        renderer->cols = screen_cols;
+        renderer->is_stale = true;
+    }
+
+    switch (color_scheme) {
+        case COLOR_SCHEME_DEFAULT: break;
+        case COLOR_SCHEME_HACKER: TERMINAL_RENDERER_APPEND_LITERAL(renderer, "\x1B[48;5;0m\x1B[38;5;46m"); break;
+    }
+
+    const bool redraw = renderer->is_stale;
+    if (redraw) {
+        // Clear Screen
+        TERMINAL_RENDERER_APPEND_LITERAL(renderer, "\x1B[H\x1B[2J");
+        TERMINAL_RENDERER_APPEND_LITERAL(renderer, "Press Space to step through. Press Q to exit.\n\n");
+        renderer->is_stale = false;
+    }
+
+    uint8_t *codes = renderer->codes;
+    for (size_t screen_row = 0; screen_row < screen_rows; screen_row++) {
+        uint8_t *previous = &renderer->previous[screen_row * screen_cols];
+        encode_screen_row(renderer, grid, screen_row, codes);
+
+        if (redraw) {
+            for (size_t screen_col = 0; screen_col < screen_cols; screen_col++) {
+                terminal_renderer_append_glyph(renderer, codes[screen_col], empty_cell);
+            }
+            TERMINAL_RENDERER_APPEND_LITERAL(renderer, "\n");
+            memcpy(previous, codes, screen_cols);
+            continue;
+        }
+
+        // Where the cursor is after the last emitted glyph of this row, SIZE_MAX if not in this row.
+        size_t cursor_col = SIZE_MAX;
+        for (size_t screen_col = 0; screen_col < screen_cols; screen_col++) {
+            if (codes[screen_col] == previous[screen_col]) {
+                continue;
+            }
+
+            if (cursor_col == SIZE_MAX || (screen_col - cursor_col) * glyph_bytes > TERMINAL_MAX_REPRINT_BYTES) {
+                terminal_renderer_cursor_move(renderer, screen_col + 1, screen_row + TERMINAL_GRID_FIRST_ROW);
+            } else {
+                // Close gap, cheaper than moving the cursor.
+                for (size_t gap_col = cursor_col; gap_col < screen_col; gap_col++) {
+                    terminal_renderer_append_glyph(renderer, codes[gap_col], empty_cell);
+                }
+            }
+
+            terminal_renderer_append_glyph(renderer, codes[screen_col], empty_cell);
+            previous[screen_col] = codes[screen_col];
+            cursor_col = screen_col + 1;
+        }
+    }
+
+    // Status line with the size of the last frame
+    terminal_renderer_cursor_move(renderer, 1, TERMINAL_GRID_FIRST_ROW - 1);
+    terminal_renderer_append_format(renderer, "Last frame: %zu bytes\x1B[K", renderer->last_frame_bytes);
+    terminal_renderer_cursor_move(renderer, 1, screen_rows + TERMINAL_GRID_FIRST_ROW);
+    TERMINAL_RENDERER_APPEND_LITERAL(renderer, "\x1B[0m");
+
+    terminal_renderer_flush(renderer);
+    STATS_END(STATS_PHASE_RENDER);
+}
+
+bool is_digit(const char input) {
+    switch (input) {
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return true;
+    }
+
+    return false;
+}
+
+void set_starting_input(Simulation *simulation, const char *input, const size_t input_len) {
+    if (input_len == 0) return;
+
+    // Parse user input
+    #define PARSE_AND_SET_NUMBERS()                                 \
+        if (numbers[0].is_some && numbers[1].is_some) {             \
+            size_t positions[2] = {0};                              \
+            positions[0] = atoi(numbers[0].digits);                 \
+            positions[1] = atoi(numbers[1].digits);                 \
+            simulation_set(simulation, positions[0], positions[1], true); \
+        }
+
+    typedef struct {
+        // Up to 99_999 must be enough.
+        char digits[5];
+        bool is_some;
+    } Number_Or_None;
+
+    Number_Or_None numbers[2] = {}; // [0] => row, [1] => col
+    size_t number_idx = 0;
+    size_t digit_idx = 0;
+    for (size_t idx = 0; idx < input_len; idx++) {
+        char c = input[idx];
+
+        if (c == ' ') {
+            if (number_idx == 1) {
+                PARSE_AND_SET_NUMBERS();
+            }
+
+            number_idx = 0;
+            digit_idx = 0;
+            for (size_t i = 0; i < 2; i++) {
+                numbers[i].is_some = false;
+                for (size_t j = 0; j < 5; j++) {
+                    numbers[i].digits[j] = 0;
+                }
+            }
+            continue;
+        }
+
+        if (is_digit(c)) {
             numbers[number_idx].is_some = true;
             numbers[number_idx].digits[digit_idx] = c;
             digit_idx++;
@@ -386,8 +5998,8 @@ void set_starting_input(Cell_Array_2d *grid, const char *input, const size_t inp
     PARSE_AND_SET_NUMBERS();
 }
 
-void terminal_get_starting_input(Cell_Array_2d *grid, const Color_Scheme color_scheme) {
-    render_terminal(*grid, color_scheme);
+void terminal_get_starting_input(Simulation *simulation, Terminal_Renderer *renderer, const Color_Scheme color_scheme) {
+    render_terminal(renderer, simulation_grid(simulation), color_scheme);
     printf(
         "Give some starting input.\n"
         "The top left is 0,0 and the format is row,col.\n"
@@ -402,185 +6014,1053 @@ void terminal_get_starting_input(Cell_Array_2d *grid, const Color_Scheme color_s
     if (line_length == -1) {
         PRINT_ERR("Failed reading starting input!\n");
         free(line);
-        cell_array_free_ptr(grid);
+        simulation_free(simulation);
         exit(EX_INPUT_READ_ERROR);
     }
     // Remove newline
     line[line_length - 1] = '\0';
 
-    set_starting_input(grid, line, line_length);
+    set_starting_input(simulation, line, line_length);
+    // The prompt is still on screen.
+    renderer->is_stale = true;
+
+    free(line);
+}
+
+void run_terminal(
+    Simulation *simulation,
+    const bool step_manually,
+    const Color_Scheme color_scheme,
+    const Render_Mode render_mode,
+    const double target_ups,
+    const uint64_t generations
+) {
+    setup_ctrlc_handler();
+    Terminal_Renderer renderer = terminal_renderer_init(render_mode);
+    terminal_get_starting_input(simulation, &renderer, color_scheme);
+    simulation_advance(simulation, generations);
+
+    // Init terminal and Quit input
+    cursor_visible(false);
+    enable_raw_mode();
+    pthread_t input_thread_id;
+    if (!step_manually) {
+        pthread_create(&input_thread_id, NULL, check_input_terminal, NULL);
+    }
+
+    // A frame that is late is dropped, there is no point in drawing the same one twice.
+    #define TERMINAL_FPS 60
+    Scheduler frame_scheduler = scheduler_init(TERMINAL_FPS, false);
+    uint64_t dropped_steps = 0;
+    {
+        // The simulation steps on its own thread, this one only draws what it published.
+        Simulation_Thread simulation_thread;
+        simulation_thread_start(&simulation_thread, simulation, target_ups, step_manually, false);
+
+        if (step_manually) {
+            while (running) {
+                render_terminal(&renderer, simulation_thread_grid(&simulation_thread), color_scheme);
+
+                const char input = getchar();
+                if (input == 'q' || input == 'Q') {
+                    running = false;
+                    break;
+                }
+
+                simulation_thread_request_step(&simulation_thread);
+                while (running && !simulation_thread_poll(&simulation_thread)) {
+                    const struct timespec idle = { .tv_sec = 0, .tv_nsec = SIMULATION_THREAD_IDLE_NS };
+                    nanosleep(&idle, NULL);
+                }
+            }
+        } else {
+            while (running) {
+                // Only draw when there is a new generation.
+                if (simulation_thread_poll(&simulation_thread)) {
+                    render_terminal(&renderer, simulation_thread_grid(&simulation_thread), color_scheme);
+                }
+
+                scheduler_wait(&frame_scheduler, NULL);
+            }
+        }
+
+        simulation_thread_stop(&simulation_thread);
+        dropped_steps = simulation_thread.dropped_steps;
+    }
+
+    // Uninit terminal and Quit input
+    if (!step_manually) {
+        pthread_join(input_thread_id, NULL);
+    }
+    cursor_visible(true);
+
+    if (renderer.frame_count > 0) {
+        printf(
+            "Rendered %" PRIu64 " frames, %.0f bytes per frame on average. Dropped %" PRIu64 " frames and %" PRIu64 " generations.\n",
+            renderer.frame_count, (double)renderer.total_bytes / renderer.frame_count,
+            frame_scheduler.dropped_ticks, dropped_steps
+        );
+    }
+    terminal_renderer_free(&renderer);
+}
+
+/**
+*   Steps the simulation `generations` times as fast as possible, without rendering or
+*   reading input, and prints how fast that was.
+*/
+void run_headless(Simulation *simulation, const uint64_t generations, const size_t thread_count) {
+    setup_ctrlc_handler();
+
+    struct timespec time_start, time_end;
+    const uint64_t generation_start = simulation->generation;
+    const uint64_t sparse_cell_updates_start = simulation->sparse != NULL ? simulation->sparse->cell_updates : 0;
+    clock_gettime(CLOCK_MONOTONIC, &time_start);
+
+    simulation_advance(simulation, generations);
+
+    clock_gettime(CLOCK_MONOTONIC, &time_end);
+    const double seconds = (time_end.tv_sec - time_start.tv_sec) + (time_end.tv_nsec - time_start.tv_nsec) / 1e9;
+    const uint64_t generations_done = simulation->generation - generation_start;
+    // The sparse engine steps its chunks instead of the grid window. Hashlife skips most of
+    // the cells through memoization, so it has no meaningful count and leaves it out.
+    const double cell_updates = simulation->engine == ENGINE_SPARSE
+        ? (double)(simulation->sparse->cell_updates - sparse_cell_updates_start)
+        : (double)generations_done * simulation->rows * simulation->cols;
+
+    char rule[RULE_STRING_SIZE];
+    rule_to_string(life_rule, rule);
+
+    printf("engine:           %s\n", engine_to_string(simulation->engine));
+    printf("rule:             %s\n", rule);
+    if (simulation->engine == ENGINE_BOOL) {
+        printf("kernel:           %s\n", row_kernel_name);
+    } else
+    if (simulation->engine != ENGINE_HASHLIFE) {
+        printf("kernel:           %s\n", rule_kernel_name);
+    }
+    printf("threads:          %zu\n", thread_count);
+    printf("grid:             %zux%zu%s\n", simulation->rows, simulation->cols, simulation->wrap ? " torus" : "");
+    printf("generations:      %" PRIu64 "\n", generations_done);
+    printf("seconds:          %.6f\n", seconds);
+    printf("generations/sec:  %.2f\n", seconds > 0 ? generations_done / seconds : 0);
+    if (simulation->engine != ENGINE_HASHLIFE) {
+        printf("cell updates/sec: %.4g\n", seconds > 0 ? cell_updates / seconds : 0);
+    }
+    if (simulation->tiles_changed != NULL) {
+        printf("active tiles:     %zu of %zu\n", simulation->active_tile_count, simulation->tile_rows * simulation->tile_cols);
+    }
+    printf("population:       %" PRIu64 "\n", simulation_population(simulation));
+}
+
+// Generations stepped before measuring, so caches and memoization are warmed up.
+#define BENCH_WARMUP_GENERATIONS 8
+// Enough samples that the p99 has 5 slower ones above it instead of being the maximum.
+#define BENCH_GENERATIONS 500
+
+static int compare_uint64(const void *a, const void *b) {
+    const uint64_t lhs = *(const uint64_t*)a;
+    const uint64_t rhs = *(const uint64_t*)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+*   Steps every engine through a fixed matrix of workloads and grid sizes and prints the
+*   median and 99th percentile time per generation of each as CSV.
+*/
+void run_bench(const size_t thread_count, const bool active_tiles, const uint64_t seed) {
+    const size_t sizes[] = { 256, 1024, 2048 };
+    const double soup_densities[] = { 0.1, 0.35, 0.5 };
+    const size_t workload_count = PATTERN_COUNT + ARR_LEN(soup_densities);
+
+    setup_ctrlc_handler();
+    printf("workload,engine,kernel,threads,rows,cols,generations,median_ns,p99_ns,population\n");
+
+    uint64_t generation_ns[BENCH_GENERATIONS];
+    for (size_t size_idx = 0; size_idx < ARR_LEN(sizes); size_idx++) {
+        const size_t size = sizes[size_idx];
+
+        for (size_t workload = 0; workload < workload_count; workload++) {
+            for (Engine engine = ENGINE_BOOL; engine < ENGINE_COUNT; engine++) {
+                if (!running) {
+                    return;
+                }
+                if (!rule_keeps_empty_dead(life_rule) && (engine == ENGINE_HASHLIFE || engine == ENGINE_SPARSE)) {
+                    continue;
+                }
+                // Random soups have nothing for Hashlife to reuse, a single generation takes seconds.
+                if (engine == ENGINE_HASHLIFE && workload >= PATTERN_COUNT) {
+                    continue;
+                }
+
+                Simulation simulation = simulation_init(size, size, engine, thread_count, active_tiles, false);
+
+                char workload_name[32];
+                if (workload < PATTERN_COUNT) {
+                    const Pattern *pattern = &PATTERNS[workload];
+                    snprintf(workload_name, sizeof(workload_name), "%s", pattern->name);
+                    // Centered so the bounded and unbounded engines see the same thing for a while.
+                    simulation_place_pattern(&simulation, pattern, size / 2 - 6, size / 2 - 19);
+                } else {
+                    const double density = soup_densities[workload - PATTERN_COUNT];
+                    snprintf(workload_name, sizeof(workload_name), "soup-%.2f", density);
+                    simulation_fill_soup(&simulation, seed, density);
+                }
+
+                simulation_advance(&simulation, BENCH_WARMUP_GENERATIONS);
+                for (size_t generation = 0; generation < BENCH_GENERATIONS; generation++) {
+                    const uint64_t start_ns = monotonic_ns();
+                    step(&simulation);
+                    generation_ns[generation] = monotonic_ns() - start_ns;
+                }
+                qsort(generation_ns, BENCH_GENERATIONS, sizeof(uint64_t), compare_uint64);
+
+                printf(
+                    "%s,%s,%s,%zu,%zu,%zu,%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                    workload_name,
+                    engine_to_string(engine),
+                    engine == ENGINE_BOOL ? row_kernel_name : engine == ENGINE_HASHLIFE ? "" : rule_kernel_name,
+                    thread_count,
+                    size, size,
+                    BENCH_GENERATIONS,
+                    generation_ns[BENCH_GENERATIONS / 2],
+                    generation_ns[(BENCH_GENERATIONS * 99 + 99) / 100 - 1],
+                    simulation_population(&simulation)
+                );
+                fflush(stdout);
+
+                simulation_free(&simulation);
+            }
+        }
+    }
+}
+
+#define SELF_TEST_GENERATIONS 100
+
+// Prints the failed check like PRINT_ERR and marks the self test as failed.
+#define SELF_TEST_CHECK(passed, condition, fmt, ...)                         \
+    if (!(condition)) {                                                      \
+        PRINT_ERR("Self test failed: " fmt __VA_OPT__(,) __VA_ARGS__);       \
+        passed = false;                                                      \
+    }
+
+/**
+*   Checks that stepping any engine never allocates grids, on 1 and several threads.
+*
+*   # Returns
+*
+*   If all checks passed.
+*/
+static bool self_test_step_allocations(void) {
+    const size_t thread_counts[] = { 1, 4 };
+    bool passed = true;
+
+    for (Engine engine = ENGINE_BOOL; engine < ENGINE_COUNT; engine++) {
+        for (size_t thread_idx = 0; thread_idx < ARR_LEN(thread_counts); thread_idx++) {
+            Simulation simulation = simulation_init(64, 64, engine, thread_counts[thread_idx], false, false);
+            simulation_place_pattern(&simulation, &PATTERNS[PATTERN_GLIDER_GUN], 26, 13);
+
+            const size_t allocation_count = cell_array_allocation_count;
+            simulation_advance(&simulation, SELF_TEST_GENERATIONS);
+            SELF_TEST_CHECK(
+                passed, cell_array_allocation_count == allocation_count,
+                "Stepping the %s engine on %zu threads allocated %zu grids.\n",
+                engine_to_string(engine), thread_counts[thread_idx], cell_array_allocation_count - allocation_count
+            );
+
+            simulation_free(&simulation);
+        }
+    }
+
+    return passed;
+}
+
+// Big enough that nothing the built in patterns send out reaches the edge within SELF_TEST_GENERATIONS.
+#define SELF_TEST_GRID_SIZE 256
+// Small enough that Hashlife collects garbage many times within SELF_TEST_GENERATIONS.
+#define SELF_TEST_HASHLIFE_MAX_NODES 512
+
+static bool self_test_grids_equal(Simulation *simulation, Simulation *reference) {
+    const Cell_Array_2d grid = simulation_grid(simulation);
+    const Cell_Array_2d reference_grid = simulation_grid(reference);
+    for (size_t row = 0; row < grid.rows; row++) {
+        if (memcmp(cell_array_row(grid, row), cell_array_row(reference_grid, row), grid.cols) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+*   Checks that every engine matches the bool engine on the built in patterns, while the
+*   pattern stays inside the grid. Hashlife is checked stepping one generation at a time,
+*   jumping to the last generation and collecting garbage all the time.
+*/
+static bool self_test_engines_match(void) {
+    typedef enum {
+        VARIANT_BITPACKED,
+        VARIANT_SPARSE,
+        VARIANT_HASHLIFE_STEP,
+        VARIANT_HASHLIFE_GC,
+        VARIANT_HASHLIFE_JUMP,
+        VARIANT_COUNT,
+    } Variant;
+    static const char *variant_names[VARIANT_COUNT] = {
+        [VARIANT_BITPACKED]     = "bitpacked",
+        [VARIANT_SPARSE]        = "sparse",
+        [VARIANT_HASHLIFE_STEP] = "hashlife",
+        [VARIANT_HASHLIFE_GC]   = "hashlife with garbage collection",
+        [VARIANT_HASHLIFE_JUMP] = "hashlife jumping",
+    };
+    static const Engine variant_engines[VARIANT_COUNT] = {
+        [VARIANT_BITPACKED]     = ENGINE_BITPACKED,
+        [VARIANT_SPARSE]        = ENGINE_SPARSE,
+        [VARIANT_HASHLIFE_STEP] = ENGINE_HASHLIFE,
+        [VARIANT_HASHLIFE_GC]   = ENGINE_HASHLIFE,
+        [VARIANT_HASHLIFE_JUMP] = ENGINE_HASHLIFE,
+    };
+    bool passed = true;
+
+    for (Pattern_Id pattern_id = PATTERN_GLIDER_GUN; pattern_id < PATTERN_COUNT; pattern_id++) {
+        const Pattern *pattern = &PATTERNS[pattern_id];
+        const size_t row = SELF_TEST_GRID_SIZE / 2 - 6;
+        const size_t col = SELF_TEST_GRID_SIZE / 2 - 19;
+
+        Simulation reference = simulation_init(SELF_TEST_GRID_SIZE, SELF_TEST_GRID_SIZE, ENGINE_BOOL, 1, false, false);
+        simulation_place_pattern(&reference, pattern, row, col);
+
+        Simulation simulations[VARIANT_COUNT];
+        for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+            simulations[variant] = simulation_init(
+                SELF_TEST_GRID_SIZE, SELF_TEST_GRID_SIZE, variant_engines[variant], 1, false, false
+            );
+            simulation_place_pattern(&simulations[variant], pattern, row, col);
+        }
+        simulations[VARIANT_HASHLIFE_GC].hashlife->max_nodes = SELF_TEST_HASHLIFE_MAX_NODES;
+
+        // The first generation that differs, reported once per variant.
+        bool matched[VARIANT_COUNT];
+        memset(matched, true, sizeof(matched));
+        for (uint64_t generation = 1; generation <= SELF_TEST_GENERATIONS; generation++) {
+            step(&reference);
+            for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+                if (variant == VARIANT_HASHLIFE_JUMP) {
+                    continue;
+                }
+                step(&simulations[variant]);
+                if (matched[variant] && !self_test_grids_equal(&simulations[variant], &reference)) {
+                    matched[variant] = false;
+                    SELF_TEST_CHECK(
+                        passed, false, "The %s engine differs from the bool engine on %s in generation %" PRIu64 ".\n",
+                        variant_names[variant], pattern->name, generation
+                    );
+                }
+            }
+        }
+
+        simulation_advance(&simulations[VARIANT_HASHLIFE_JUMP], SELF_TEST_GENERATIONS);
+        SELF_TEST_CHECK(
+            passed, self_test_grids_equal(&simulations[VARIANT_HASHLIFE_JUMP], &reference),
+            "The %s engine differs from the bool engine on %s in generation %d.\n",
+            variant_names[VARIANT_HASHLIFE_JUMP], pattern->name, SELF_TEST_GENERATIONS
+        );
+        // Collected nodes end up in the free list.
+        SELF_TEST_CHECK(
+            passed, simulations[VARIANT_HASHLIFE_GC].hashlife->free_nodes != NULL,
+            "Hashlife never collected garbage on %s with at most %d nodes.\n",
+            pattern->name, SELF_TEST_HASHLIFE_MAX_NODES
+        );
+
+        for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+            simulation_free(&simulations[variant]);
+        }
+        simulation_free(&reference);
+    }
+
+    return passed;
+}
+
+// Not a multiple of the word size, so the bitpacked engine steps a partial last word.
+#define SELF_TEST_SOUP_SIZE 100
+#define SELF_TEST_SOUP_SEED 1
+
+/**
+*   Checks that the bitpacked engine and the counting kernels of both grid engines match the
+*   bool engine under rules with specialized kernels and rules going through the generic and
+*   table ones, starting from a random soup. The counting kernels also have to keep the
+*   population of the metrics right. Selects the rule of the command line again at the end.
+*/
+static bool self_test_rules_match(void) {
+    typedef enum {
+        VARIANT_BITPACKED,
+        VARIANT_BOOL_COUNTING,
+        VARIANT_BITPACKED_COUNTING,
+        VARIANT_COUNT,
+    } Variant;
+    static const char *variant_names[VARIANT_COUNT] = {
+        [VARIANT_BITPACKED]          = "bitpacked",
+        [VARIANT_BOOL_COUNTING]      = "counting bool",
+        [VARIANT_BITPACKED_COUNTING] = "counting bitpacked",
+    };
+    static const Engine variant_engines[VARIANT_COUNT] = {
+        [VARIANT_BITPACKED]          = ENGINE_BITPACKED,
+        [VARIANT_BOOL_COUNTING]      = ENGINE_BOOL,
+        [VARIANT_BITPACKED_COUNTING] = ENGINE_BITPACKED,
+    };
+    // Conway, HighLife and Seeds are specialized, Morley and Diamoeba are not.
+    static const char *rule_strings[] = { "B3/S23", "B36/S23", "B2/S", "B368/S245", "B35678/S5678" };
+    const Rule selected_rule = life_rule;
+    bool passed = true;
+
+    for (size_t rule_idx = 0; rule_idx < ARR_LEN(rule_strings); rule_idx++) {
+        Rule rule;
+        rule_parse(rule_strings[rule_idx], &rule);
+        rule_select(rule);
+        row_kernel_select();
+
+        Simulation reference = simulation_init(SELF_TEST_SOUP_SIZE, SELF_TEST_SOUP_SIZE, ENGINE_BOOL, 1, false, false);
+        simulation_fill_soup(&reference, SELF_TEST_SOUP_SEED, 0.5);
+
+        Simulation simulations[VARIANT_COUNT];
+        for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+            simulations[variant] = simulation_init(
+                SELF_TEST_SOUP_SIZE, SELF_TEST_SOUP_SIZE, variant_engines[variant], 1, false, false
+            );
+            if (variant == VARIANT_BOOL_COUNTING || variant == VARIANT_BITPACKED_COUNTING) {
+                simulation_write_metrics(&simulations[variant], "/dev/null");
+            }
+            simulation_fill_soup(&simulations[variant], SELF_TEST_SOUP_SEED, 0.5);
+        }
+
+        // The first generation that differs, reported once per variant.
+        bool matched[VARIANT_COUNT];
+        memset(matched, true, sizeof(matched));
+        for (uint64_t generation = 1; generation <= SELF_TEST_GENERATIONS; generation++) {
+            step(&reference);
+            for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+                Simulation *simulation = &simulations[variant];
+                step(simulation);
+                if (!matched[variant]) {
+                    continue;
+                }
+
+                if (!self_test_grids_equal(simulation, &reference)) {
+                    matched[variant] = false;
+                    SELF_TEST_CHECK(
+                        passed, false, "The %s engine differs from the bool engine under %s in generation %" PRIu64 ".\n",
+                        variant_names[variant], rule_strings[rule_idx], generation
+                    );
+                } else
+                if (simulation->metrics != NULL && simulation->metrics->population != simulation_population(simulation)) {
+                    matched[variant] = false;
+                    SELF_TEST_CHECK(
+                        passed, false, "The %s engine counted a population of %" PRIu64 " instead of %" PRIu64 " under %s in generation %" PRIu64 ".\n",
+                        variant_names[variant], simulation->metrics->population, simulation_population(simulation),
+                        rule_strings[rule_idx], generation
+                    );
+                }
+            }
+        }
+
+        for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+            simulation_free(&simulations[variant]);
+        }
+        simulation_free(&reference);
+    }
+
+    rule_select(selected_rule);
+    row_kernel_select();
+    return passed;
+}
+
+// Neither a multiple of the word nor the tile size, so the edges fall inside the last word and tile.
+#define SELF_TEST_TORUS_ROWS 150
+#define SELF_TEST_TORUS_COLS 200
+
+/**
+*   Checks that the ways of wrapping around a torus match, the ghost border of the bool
+*   engine, the edge words of the bitpacked engine and the active tiles treating tiles on
+*   the opposite edge as neighbors. A glider flies across the bottom right corner.
+*/
+static bool self_test_torus_match(void) {
+    typedef enum {
+        VARIANT_BOOL_TILES,
+        VARIANT_BITPACKED,
+        VARIANT_BITPACKED_TILES,
+        VARIANT_COUNT,
+    } Variant;
+    static const char *variant_names[VARIANT_COUNT] = {
+        [VARIANT_BOOL_TILES]      = "bool with active tiles",
+        [VARIANT_BITPACKED]       = "bitpacked",
+        [VARIANT_BITPACKED_TILES] = "bitpacked with active tiles",
+    };
+    static const Engine variant_engines[VARIANT_COUNT] = {
+        [VARIANT_BOOL_TILES]      = ENGINE_BOOL,
+        [VARIANT_BITPACKED]       = ENGINE_BITPACKED,
+        [VARIANT_BITPACKED_TILES] = ENGINE_BITPACKED,
+    };
+    static const bool variant_active_tiles[VARIANT_COUNT] = {
+        [VARIANT_BOOL_TILES]      = true,
+        [VARIANT_BITPACKED]       = false,
+        [VARIANT_BITPACKED_TILES] = true,
+    };
+    // Flies down and right by 1 cell every 4 generations.
+    static const uint16_t glider_cells[][2] = {
+        {0, 1},
+        {1, 2},
+        {2, 0}, {2, 1}, {2, 2},
+    };
+    static const Pattern glider = { "glider", glider_cells, ARR_LEN(glider_cells) };
+    // Crosses both edges about halfway through SELF_TEST_GENERATIONS.
+    const size_t row = SELF_TEST_TORUS_ROWS - 12;
+    const size_t col = SELF_TEST_TORUS_COLS - 12;
+    bool passed = true;
+
+    Simulation reference = simulation_init(SELF_TEST_TORUS_ROWS, SELF_TEST_TORUS_COLS, ENGINE_BOOL, 1, false, true);
+    simulation_place_pattern(&reference, &glider, row, col);
+
+    Simulation simulations[VARIANT_COUNT];
+    for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+        simulations[variant] = simulation_init(
+            SELF_TEST_TORUS_ROWS, SELF_TEST_TORUS_COLS, variant_engines[variant], 1, variant_active_tiles[variant], true
+        );
+        simulation_place_pattern(&simulations[variant], &glider, row, col);
+    }
+
+    // The first generation that differs, reported once per variant.
+    bool matched[VARIANT_COUNT];
+    memset(matched, true, sizeof(matched));
+    for (uint64_t generation = 1; generation <= SELF_TEST_GENERATIONS; generation++) {
+        step(&reference);
+        for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+            step(&simulations[variant]);
+            if (matched[variant] && !self_test_grids_equal(&simulations[variant], &reference)) {
+                matched[variant] = false;
+                SELF_TEST_CHECK(
+                    passed, false, "The %s engine differs from the bool engine on a torus in generation %" PRIu64 ".\n",
+                    variant_names[variant], generation
+                );
+            }
+        }
+    }
+
+    // A glider that got lost at an edge would still match on all engines.
+    SELF_TEST_CHECK(
+        passed, simulation_population(&reference) == glider.cell_count,
+        "The glider on a torus ended up with %" PRIu64 " cells instead of %zu.\n",
+        simulation_population(&reference), glider.cell_count
+    );
+
+    for (Variant variant = 0; variant < VARIANT_COUNT; variant++) {
+        simulation_free(&simulations[variant]);
+    }
+    simulation_free(&reference);
+
+    return passed;
+}
+
+/**
+*   Runs the built in checks of the engines and prints which ones failed.
+*
+*   # Returns
+*
+*   If all checks passed.
+*/
+bool run_self_test(void) {
+    bool passed = true;
+    passed = self_test_step_allocations() && passed;
+    passed = self_test_engines_match() && passed;
+    passed = self_test_rules_match() && passed;
+    passed = self_test_torus_match() && passed;
+
+    printf("self test %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+// Used by --soup-search when there is no --soup or --generations.
+#define SOUP_SEARCH_DEFAULT_DENSITY 0.5
+#define SOUP_SEARCH_DEFAULT_GENERATIONS 10000
+
+/**
+*  What a worker of the soup search found in the soups it ran, merged into one report by
+*  `run_soup_search`.
+*/
+typedef struct {
+    uint64_t soup_count;
+    // Soups that ended in a still life or oscillator before the generation limit.
+    uint64_t stabilized_count;
+    uint64_t died_out_count;
+    // Summed over the stabilized soups.
+    uint64_t generations_sum;
+    uint64_t population_sum;
+
+    // The stabilized soup that took the most generations, and the one that ended with the most cells.
+    uint64_t longest_generations;
+    uint64_t longest_seed;
+    uint64_t largest_population;
+    uint64_t largest_seed;
+
+    // How many soups ended in a cycle of every period, index 1 are still lifes.
+    uint64_t period_counts[CYCLE_HISTORY_SIZE + 1];
+} Soup_Search_Results;
+
+/**
+*  Seeds `[next, end)` that are left for one worker.
+*
+*  The worker takes them one by one from the front. When its own range runs out it steals
+*  the back half of another worker's range, so workers that got quick soups help out the
+*  ones that got slow soups until every seed is taken.
+*/
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t next;
+    uint64_t end;
+} Seed_Range;
+
+typedef struct {
+    // One per worker, allocated once and reused for every soup.
+    Simulation *simulations;
+    Seed_Range *ranges;
+    Soup_Search_Results *results;
+    size_t worker_count;
+    double density;
+    uint64_t max_generations;
+} Soup_Search;
+
+// Takes the next seed of `range`, returns false if it is empty.
+static bool seed_range_pop(Seed_Range *range, uint64_t *seed) {
+    pthread_mutex_lock(&range->lock);
+    const bool found = range->next < range->end;
+    if (found) {
+        *seed = range->next++;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+/**
+*   Moves the back half of the first other range that has seeds left into the empty range
+*   of `worker_idx`.
+*
+*   # Returns
+*
+*   If there was anything left to steal.
+*/
+static bool soup_search_steal(Soup_Search *search, const size_t worker_idx) {
+    for (size_t offset = 1; offset < search->worker_count; offset++) {
+        Seed_Range *victim = &search->ranges[(worker_idx + offset) % search->worker_count];
+
+        pthread_mutex_lock(&victim->lock);
+        const uint64_t left = victim->end - victim->next;
+        const uint64_t stolen_next = victim->end - (left + 1) / 2;
+        const uint64_t stolen_end = victim->end;
+        victim->end = stolen_next;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (left > 0) {
+            Seed_Range *range = &search->ranges[worker_idx];
+            pthread_mutex_lock(&range->lock);
+            range->next = stolen_next;
+            range->end = stolen_end;
+            pthread_mutex_unlock(&range->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Runs the soup of `seed` until it stabilizes or reaches the generation limit and adds it to `results`.
+static void soup_search_run(Soup_Search *search, Simulation *simulation, const uint64_t seed, Soup_Search_Results *results) {
+    // Every cell is overwritten, so the simulation starts over without allocating anything.
+    simulation->generation = 0;
+    simulation_fill_soup(simulation, seed, search->density);
+    Cycle_Detector *cycles = simulation->cycles;
+    cycles->period = 0;
+    cycles->cycle_start = 0;
+
+    simulation_advance(simulation, search->max_generations);
+    if (cycles->period == 0) {
+        // Either still going at the limit or interrupted by CTRL+C, neither is an outcome.
+        results->soup_count += simulation->generation == search->max_generations;
+        return;
+    }
+
+    const uint64_t population = simulation_population(simulation);
+    results->soup_count++;
+    results->stabilized_count++;
+    results->died_out_count += population == 0;
+    results->generations_sum += cycles->cycle_start;
+    results->population_sum += population;
+    results->period_counts[cycles->period]++;
+    if (cycles->cycle_start > results->longest_generations || results->stabilized_count == 1) {
+        results->longest_generations = cycles->cycle_start;
+        results->longest_seed = seed;
+    }
+    if (population > results->largest_population || results->stabilized_count == 1) {
+        results->largest_population = population;
+        results->largest_seed = seed;
+    }
+}
+
+void soup_search_band(void *data, const size_t worker_idx, const size_t worker_count) {
+    UNUSED(worker_count);
+    Soup_Search *search = data;
+
+    uint64_t seed;
+    while (running) {
+        if (!seed_range_pop(&search->ranges[worker_idx], &seed)) {
+            if (!soup_search_steal(search, worker_idx)) {
+                break;
+            }
+            continue;
+        }
+        soup_search_run(search, &search->simulations[worker_idx], seed, &search->results[worker_idx]);
+    }
+}
+
+/**
+*   Runs the soups of the seeds `[first_seed, last_seed]` on `thread_count` threads until
+*   they stabilize, and prints how they ended and how many soups per second that took.
+*/
+void run_soup_search(
+    const size_t rows, const size_t cols,
+    const Engine engine,
+    const double density,
+    const uint64_t max_generations,
+    const uint64_t first_seed, const uint64_t last_seed,
+    const size_t thread_count,
+    const bool active_tiles,
+    const bool wrap
+) {
+    setup_ctrlc_handler();
+
+    // Every soup fits on one thread, so the threads run soups instead of bands of one grid.
+    Worker_Pool *pool = thread_count > 1 ? worker_pool_init(thread_count) : NULL;
+    Soup_Search search = {
+        .simulations = malloc(sizeof(Simulation) * thread_count),
+        .ranges = malloc(sizeof(Seed_Range) * thread_count),
+        .results = calloc(thread_count, sizeof(Soup_Search_Results)),
+        .worker_count = thread_count,
+        .density = density,
+        .max_generations = max_generations,
+    };
+    if (search.simulations == NULL || search.ranges == NULL || search.results == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the soup search!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
+
+    // The seeds start out split evenly, `parse_arguments` keeps `last_seed + 1` from overflowing.
+    const uint64_t seed_count = last_seed + 1 - first_seed;
+    for (size_t idx = 0; idx < thread_count; idx++) {
+        search.simulations[idx] = simulation_init(rows, cols, engine, 1, active_tiles, wrap);
+        simulation_detect_cycles(&search.simulations[idx], CYCLE_ACTION_STOP);
+
+        pthread_mutex_init(&search.ranges[idx].lock, NULL);
+        search.ranges[idx].next = first_seed + seed_count / thread_count * idx + MIN(idx, seed_count % thread_count);
+        search.ranges[idx].end = first_seed + seed_count / thread_count * (idx + 1) + MIN(idx + 1, seed_count % thread_count);
+    }
+
+    const uint64_t start_ns = monotonic_ns();
+    if (pool != NULL) {
+        worker_pool_run(pool, soup_search_band, &search);
+    } else {
+        soup_search_band(&search, 0, 1);
+    }
+    const double seconds = (monotonic_ns() - start_ns) / 1e9;
+
+    Soup_Search_Results total = search.results[0];
+    for (size_t idx = 1; idx < thread_count; idx++) {
+        const Soup_Search_Results *results = &search.results[idx];
+        if (results->stabilized_count > 0) {
+            if (total.stabilized_count == 0
+                || results->longest_generations > total.longest_generations
+                || (results->longest_generations == total.longest_generations && results->longest_seed < total.longest_seed)
+            ) {
+                total.longest_generations = results->longest_generations;
+                total.longest_seed = results->longest_seed;
+            }
+            if (total.stabilized_count == 0
+                || results->largest_population > total.largest_population
+                || (results->largest_population == total.largest_population && results->largest_seed < total.largest_seed)
+            ) {
+                total.largest_population = results->largest_population;
+                total.largest_seed = results->largest_seed;
+            }
+        }
+
+        total.soup_count += results->soup_count;
+        total.stabilized_count += results->stabilized_count;
+        total.died_out_count += results->died_out_count;
+        total.generations_sum += results->generations_sum;
+        total.population_sum += results->population_sum;
+        for (size_t period = 1; period <= CYCLE_HISTORY_SIZE; period++) {
+            total.period_counts[period] += results->period_counts[period];
+        }
+    }
+
+    char rule[RULE_STRING_SIZE];
+    rule_to_string(life_rule, rule);
+
+    printf("engine:           %s\n", engine_to_string(engine));
+    printf("rule:             %s\n", rule);
+    printf("threads:          %zu\n", thread_count);
+    printf("grid:             %zux%zu%s\n", rows, cols, wrap ? " torus" : "");
+    printf("density:          %.3f\n", density);
+    printf("seeds:            %" PRIu64 "..%" PRIu64 "\n", first_seed, last_seed);
+    printf("soups:            %" PRIu64 "\n", total.soup_count);
+    printf("seconds:          %.6f\n", seconds);
+    printf("soups/sec:        %.2f\n", seconds > 0 ? total.soup_count / seconds : 0);
+    printf(
+        "stabilized:       %" PRIu64 " (%" PRIu64 " still running after %" PRIu64 " generations)\n",
+        total.stabilized_count, total.soup_count - total.stabilized_count, max_generations
+    );
+    if (total.stabilized_count > 0) {
+        printf("died out:         %" PRIu64 "\n", total.died_out_count);
+        printf(
+            "generations:      mean %.1f, longest %" PRIu64 " (seed %" PRIu64 ")\n",
+            (double)total.generations_sum / total.stabilized_count, total.longest_generations, total.longest_seed
+        );
+        printf(
+            "population:       mean %.1f, largest %" PRIu64 " (seed %" PRIu64 ")\n",
+            (double)total.population_sum / total.stabilized_count, total.largest_population, total.largest_seed
+        );
+        for (size_t period = 1; period <= CYCLE_HISTORY_SIZE; period++) {
+            if (total.period_counts[period] > 0) {
+                printf("period %-4zu       %" PRIu64 "\n", period, total.period_counts[period]);
+            }
+        }
+    }
+
+    if (pool != NULL) {
+        worker_pool_free(pool);
+    }
+    for (size_t idx = 0; idx < thread_count; idx++) {
+        simulation_free(&search.simulations[idx]);
+        pthread_mutex_destroy(&search.ranges[idx].lock);
+    }
+    free(search.simulations);
+    free(search.ranges);
+    free(search.results);
+}
+
+/**
+*  What part of the grid is shown. `row` and `col` is the cell at the top left of the grid area,
+*  they can be fractional and negative, and `zoom` is how many pixels wide a cell is.
+*/
+typedef struct {
+    double row;
+    double col;
+    double zoom;
+} Raylib_Viewport;
 
-    free(line);
+#define RAYLIB_MAX_ZOOM 64.0
+#define RAYLIB_ZOOM_STEP 1.15
+
+// The whole grid fits into the area.
+static inline double raylib_fit_zoom(const size_t rows, const size_t cols, const Rectangle area) {
+    return MIN(area.width / cols, area.height / rows);
 }
 
-void run_terminal(Cell_Array_2d *grid, const bool step_manually, const Color_Scheme color_scheme) {
-    setup_ctrlc_handler();
-    terminal_get_starting_input(grid, color_scheme);
+/**
+*   Zooms with the mouse wheel around the mouse and pans while the right or middle mouse button is held.
+*/
+void raylib_viewport_update(Raylib_Viewport *viewport, const size_t rows, const size_t cols, const Rectangle area) {
+    const Vector2 mouse_pos = GetMousePosition();
+
+    const float wheel = GetMouseWheelMove();
+    if (wheel != 0 && CheckCollisionPointRec(mouse_pos, area)) {
+        // Zooming out stops a bit past fitting the whole grid.
+        const double min_zoom = MIN(raylib_fit_zoom(rows, cols, area) / 2, 1);
+        const double zoom = CLAMP(viewport->zoom * pow(RAYLIB_ZOOM_STEP, wheel), min_zoom, RAYLIB_MAX_ZOOM);
+
+        // Keep the cell under the mouse where it is.
+        const double mouse_row = viewport->row + (mouse_pos.y - area.y) / viewport->zoom;
+        const double mouse_col = viewport->col + (mouse_pos.x - area.x) / viewport->zoom;
+        viewport->row = mouse_row - (mouse_pos.y - area.y) / zoom;
+        viewport->col = mouse_col - (mouse_pos.x - area.x) / zoom;
+        viewport->zoom = zoom;
+    }
 
-    // Init terminal and Quit input
-    cursor_visible(false);
-    enable_raw_mode();
-    pthread_t input_thread_id;
-    if (!step_manually) {
-        pthread_create(&input_thread_id, NULL, check_input_terminal, NULL);
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || IsMouseButtonDown(MOUSE_BUTTON_MIDDLE)) {
+        const Vector2 mouse_delta = GetMouseDelta();
+        viewport->row -= mouse_delta.y / viewport->zoom;
+        viewport->col -= mouse_delta.x / viewport->zoom;
     }
 
-    {
-        #define US_PER_FRAME 400000 // ~60 FPS
-        /* #define US_PER_FRAME 1 // MAX SPEED */
-        struct timeval time_delta, time_start, time_end;
-        double accumulator = 0;
-        gettimeofday(&time_end, NULL);
-
-        // Timekeeping
-        while (running) {
-            gettimeofday(&time_start, NULL);
-            time_delta.tv_usec = time_end.tv_usec - time_start.tv_usec;
-            // C is just too fast
-            accumulator += time_delta.tv_usec == 0 ? 1 : time_delta.tv_usec;
-
-            if (step_manually) {
-                char input = ' ';
-                while (input == ' ') {
-                    render_terminal(*grid, color_scheme);
-
-                    input = getchar();
-                    if (input == 'q') {
-                        running = false;
-                        break;
-                    }
+    // At least one row and column stay in view.
+    viewport->row = CLAMP(viewport->row, 1 - area.height / viewport->zoom, rows - 1.0);
+    viewport->col = CLAMP(viewport->col, 1 - area.width / viewport->zoom, cols - 1.0);
+}
 
-                    step(grid);
-                }
-            } else {
-                while (accumulator >= US_PER_FRAME) {
-                    accumulator -= US_PER_FRAME;
-                    step(grid);
+/**
+*  Pixels for the visible part of the grid, one texel per visible cell or block of cells.
+*  Only what is in view is written and uploaded, so a frame costs about as much as the
+*  grid area has pixels, whatever the size of the grid.
+*/
+typedef struct {
+    Texture2D texture;
+    Color *pixels;
+    size_t width;
+    size_t height;
+} Raylib_Grid_Texture;
+
+// Grid lines are only drawn when cells are at least this many pixels big, below that they cover the cells.
+#define RAYLIB_MIN_GRID_LINE_CELL_SIZE 4
+
+// Needs an open window.
+Raylib_Grid_Texture raylib_grid_texture_init(const size_t width, const size_t height) {
+    Raylib_Grid_Texture grid_texture = {
+        .pixels = malloc(sizeof(Color) * width * height),
+        .width = width,
+        .height = height,
+    };
+    if (grid_texture.pixels == NULL) {
+        PRINT_ERR_LOC("Failed allocating memory for the grid texture!\n");
+        exit(EX_MEMORY_ALLOCATION);
+    }
 
-                    render_terminal(*grid, color_scheme);
-                }
-            }
+    const Image image = GenImageColor(width, height, BLANK);
+    grid_texture.texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    // Sharp cell edges when scaled up.
+    SetTextureFilter(grid_texture.texture, TEXTURE_FILTER_POINT);
 
-            gettimeofday(&time_end, NULL);
-        }
-    }
+    return grid_texture;
+}
 
-    // Uninit terminal and Quit input
-    if (!step_manually) {
-        pthread_join(input_thread_id, NULL);
-    }
-    cursor_visible(true);
+void raylib_grid_texture_free(Raylib_Grid_Texture *grid_texture) {
+    UnloadTexture(grid_texture->texture);
+    free(grid_texture->pixels);
+    grid_texture->pixels = NULL;
 }
 
 /**
-*   # Returns
+*   Draws the part of the grid inside `viewport` into `area`.
 *
-*   The grid area width and height.
+*   Zoomed out past one cell per pixel every texel is a block of cells from `density`, whose
+*   level is picked so a block is about a pixel, and shows how many of its cells are alive.
 */
-Vector2 raylib_draw_grid(
+void raylib_draw_grid(
+    Raylib_Grid_Texture *grid_texture,
     const Cell_Array_2d grid,
-    const size_t grid_padding_top,
-    const size_t grid_padding_right,
-    const size_t grid_padding_left,
-    const size_t grid_padding_bottom,
-    const size_t cell_padding,
-    const double window_width,
-    const double window_height,
+    const Density_Pyramid *density,
+    const Raylib_Viewport viewport,
+    const Rectangle area,
     const Color_Scheme color_scheme,
     const bool draw_grid
 ) {
-    const double grid_area_width = window_width - grid_padding_left - grid_padding_right;
-    const double grid_area_height = window_height - grid_padding_top - grid_padding_bottom;
-    const double cell_width = (grid_area_width / grid.cols) - cell_padding;
-    const double cell_height = (grid_area_height / grid.rows) - cell_padding;
+    // The texture has to hold every texel that can be visible.
+    if (grid_texture->width < area.width + 2 || grid_texture->height < area.height + 2) {
+        raylib_grid_texture_free(grid_texture);
+        *grid_texture = raylib_grid_texture_init(area.width + 2, area.height + 2);
+    }
+
+    // Level 0 are the cells themselves
+    size_t level = 0;
+    while (level < density->level_count && viewport.zoom * (UINT64_C(1) << level) < 1) {
+        level++;
+    }
+    const size_t block_size = UINT64_C(1) << level;
+    const size_t level_rows = level == 0 ? grid.rows : density->rows[level - 1];
+    const size_t level_cols = level == 0 ? grid.cols : density->cols[level - 1];
+    const double block_zoom = viewport.zoom * block_size;
+
+    // Visible blocks, everything else is culled.
+    const double first_row = viewport.row / block_size;
+    const double first_col = viewport.col / block_size;
+    const size_t row_begin = MAX(floor(first_row), 0);
+    const size_t col_begin = MAX(floor(first_col), 0);
+    const size_t row_end = CLAMP(ceil(first_row + area.height / block_zoom), 0, level_rows);
+    const size_t col_end = CLAMP(ceil(first_col + area.width / block_zoom), 0, level_cols);
+    if (row_begin >= row_end || col_begin >= col_end) {
+        return;
+    }
+    const size_t visible_rows = MIN(row_end - row_begin, grid_texture->height);
+    const size_t visible_cols = MIN(col_end - col_begin, grid_texture->width);
+
+    // Draw Alive Cells
+    // Dead cells are transparent so the background shows through.
+    const Color alive_color = GREEN;
+    const Color dead_color = BLANK;
+    for (size_t row = 0; row < visible_rows; row++) {
+        Color *pixels = &grid_texture->pixels[row * grid_texture->width];
+
+        if (level == 0) {
+            const bool *cells = &cell_array_row(grid, row_begin + row)[col_begin];
+            for (size_t col = 0; col < visible_cols; col++) {
+                pixels[col] = cells[col] ? alive_color : dead_color;
+            }
+        } else {
+            const uint32_t *counts = &density->counts[level - 1][(row_begin + row) * level_cols + col_begin];
+            const uint32_t max_count = block_size * block_size;
+            for (size_t col = 0; col < visible_cols; col++) {
+                // Blocks with any alive cell stay visible.
+                pixels[col] = alive_color;
+                pixels[col].a = counts[col] == 0 ? 0 : 64 + (191 * counts[col]) / max_count;
+            }
+        }
+    }
+    UpdateTexture(grid_texture->texture, grid_texture->pixels);
+
+    const Rectangle destination = {
+        .x = area.x + (col_begin - first_col) * block_zoom,
+        .y = area.y + (row_begin - first_row) * block_zoom,
+        .width = visible_cols * block_zoom,
+        .height = visible_rows * block_zoom,
+    };
+    // Blocks cut by the edge of the area are partly outside of it.
+    BeginScissorMode(area.x, area.y, area.width, area.height);
+    DrawTexturePro(
+        grid_texture->texture,
+        (Rectangle) { .x = 0, .y = 0, .width = visible_cols, .height = visible_rows },
+        destination,
+        (Vector2) { .x = 0, .y = 0 },
+        0,
+        WHITE
+    );
 
-    // Draw Grid
-    // Horizontal lines
-    if (color_scheme == COLOR_SCHEME_DEFAULT || draw_grid) {
-        for (size_t row = 0; row <= grid.rows; row++) {
+    // Draw Grid on top
+    if ((color_scheme == COLOR_SCHEME_DEFAULT || draw_grid)
+        && level == 0
+        && viewport.zoom >= RAYLIB_MIN_GRID_LINE_CELL_SIZE
+    ) {
+        // Horizontal lines
+        for (size_t row = 0; row <= visible_rows; row++) {
+            const float y = destination.y + row * viewport.zoom;
             DrawLineEx(
-                (Vector2) {
-                    .x = grid_padding_left,
-                    .y = grid_padding_top + cell_height * row + cell_padding * row,
-                },
-                (Vector2) {
-                    .x = window_width - grid_padding_right,
-                    .y = grid_padding_top + cell_height * row + cell_padding * row,
-                },
+                (Vector2) { .x = destination.x, .y = y },
+                (Vector2) { .x = destination.x + destination.width, .y = y },
                 1,
                 GRAY
             );
         }
         // Vertical lines
-        for (size_t col = 0; col <= grid.cols; col++) {
+        for (size_t col = 0; col <= visible_cols; col++) {
+            const float x = destination.x + col * viewport.zoom;
             DrawLineEx(
-                (Vector2) {
-                    .x = grid_padding_left + cell_width * col + cell_padding * col,
-                    .y = grid_padding_top,
-                },
-                (Vector2) {
-                    .x = grid_padding_left + cell_width * col + cell_padding * col,
-                    .y = window_height - grid_padding_bottom,
-                },
+                (Vector2) { .x = x, .y = destination.y },
+                (Vector2) { .x = x, .y = destination.y + destination.height },
                 1,
                 GRAY
             );
         }
     }
-
-    // Draw Alive Cells
-    for (size_t row = 0; row < grid.rows; row++) {
-        for (size_t col = 0; col < grid.cols; col++) {
-            if (cell_array_get(grid, row, col) == false) {
-                continue;
-            }
-
-            switch (color_scheme) {
-            case COLOR_SCHEME_DEFAULT: {
-                DrawRing(
-                    (Vector2) {
-                        .x = grid_padding_left + cell_width / 2 + cell_width * col + cell_padding * col,
-                        .y = grid_padding_top + cell_height / 2 + cell_height * row + cell_padding * row,
-                    },
-                    0,
-                    MIN(cell_width, cell_height) / 3,
-                    0,
-                    360,
-                    0,
-                    GREEN
-                );
-                break;
-            }
-
-            case COLOR_SCHEME_HACKER: {
-                DrawRectangleV(
-                    (Vector2) {
-                        .x = grid_padding_left + cell_width * col + cell_padding * col,
-                        .y = grid_padding_top + cell_height * row + cell_padding * row,
-                    },
-                    (Vector2) {
-                        .x = cell_width,
-                        .y = cell_height,
-                    },
-                    GREEN
-                );
-            break;
-            }
-            }
-        }
-    }
-
-    return (Vector2) { .x = grid_area_width, .y = grid_area_height };
+    EndScissorMode();
 }
 
-void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_fps, const Color_Scheme color_scheme) {
+void run_raylib(
+    Simulation *simulation,
+    const bool step_manually,
+    const bool show_fps,
+    const Color_Scheme color_scheme,
+    const double target_ups,
+    const uint64_t generations
+) {
     typedef enum {
         STATE_PLACING,
         STATE_SIMULATING,
     } State;
     State state = STATE_PLACING;
 
-    const size_t cell_padding = 1;
     const size_t grid_padding = 10;
 
     // HACK: Is this how you do that in raylib?! Well what works works ig...
@@ -593,11 +7073,15 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
 
     SetWindowState(FLAG_WINDOW_RESIZABLE);
     InitWindow(window_width, window_height, "Conway");
+    // Grows to the grid area on the first frame.
+    Raylib_Grid_Texture grid_texture = raylib_grid_texture_init(1, 1);
+    // Density levels while placing, the simulation thread builds its own.
+    Density_Pyramid placing_density = density_pyramid_init(simulation->rows, simulation->cols);
+    bool placing_density_is_stale = true;
 
-    // Magic timekeeping variables for a fixed timestep from the raylib examples:
-    // https://www.raylib.com/examples/core/loader.html?name=core_custom_frame_control
-    double previous_time_s = GetTime();
-    const size_t target_ups = 32;
+    // The simulation steps on its own thread once started, independent of the frame rate.
+    SetTargetFPS(60);
+    Simulation_Thread simulation_thread;
 
     const size_t font_size = 24;
     const Vector2 text_pos = {
@@ -622,6 +7106,9 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
         case COLOR_SCHEME_HACKER: ClearBackground(BLACK); break;     \
         }
 
+    // Starts out fitting the whole grid.
+    Raylib_Viewport viewport = { .row = 0, .col = 0, .zoom = 0 };
+
     while (!WindowShouldClose()) {
         if (IsKeyDown(KEY_Q)) {
             break;
@@ -632,6 +7119,20 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
             window_height = GetScreenHeight();
         }
 
+        const size_t grid_padding_top = state == STATE_PLACING ? grid_padding + font_size + text_pos.y : grid_padding;
+        const Rectangle grid_area = {
+            .x = grid_padding,
+            .y = grid_padding_top,
+            .width = MAX(window_width - grid_padding * 2, 1),
+            .height = MAX(window_height - grid_padding_top - grid_padding, 1),
+        };
+        if (viewport.zoom == 0) {
+            viewport.zoom = raylib_fit_zoom(simulation->rows, simulation->cols, grid_area);
+        }
+        STATS_BEGIN(STATS_PHASE_INPUT);
+        raylib_viewport_update(&viewport, simulation->rows, simulation->cols, grid_area);
+        STATS_END(STATS_PHASE_INPUT);
+
         switch (state) {
         case STATE_PLACING: {
             const Vector2 mouse_pos = GetMousePosition();
@@ -646,32 +7147,38 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
             {
                 DRAW_BACKGROUND();
 
-                const size_t grid_padding_top = grid_padding + font_size + text_pos.y;
-                const Vector2 grid_area_size = raylib_draw_grid(
-                    *grid,
-                    grid_padding_top, grid_padding, grid_padding, grid_padding,
-                    cell_padding,
-                    window_width,
-                    window_height,
-                    color_scheme,
-                    true
-                );
+                const Cell_Array_2d grid = simulation_grid(simulation);
+                if (placing_density_is_stale) {
+                    density_pyramid_build(&placing_density, grid);
+                    placing_density_is_stale = false;
+                }
+                STATS_BEGIN(STATS_PHASE_DRAW);
+                raylib_draw_grid(&grid_texture, grid, &placing_density, viewport, grid_area, color_scheme, true);
+                STATS_END(STATS_PHASE_DRAW);
 
-                if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+                if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mouse_pos, grid_area)) {
                     // Place the starting cells
-                    const size_t mouse_row = (mouse_pos.y - grid_padding_top) / (grid_area_size.y / grid->rows);
-                    const size_t mouse_col = (mouse_pos.x - grid_padding) / (grid_area_size.x / grid->cols);
-                    if (mouse_row < grid->rows && mouse_col < grid->cols) {
-                        cell_array_set(grid, mouse_row, mouse_col, true);
+                    const double mouse_row = floor(viewport.row + (mouse_pos.y - grid_area.y) / viewport.zoom);
+                    const double mouse_col = floor(viewport.col + (mouse_pos.x - grid_area.x) / viewport.zoom);
+                    if (mouse_row >= 0 && mouse_row < simulation->rows && mouse_col >= 0 && mouse_col < simulation->cols) {
+                        simulation_set(simulation, mouse_row, mouse_col, true);
+                        placing_density_is_stale = true;
                     }
+                }
 
+                if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
                     // Press Start Button
                     if (CheckCollisionPointRec(mouse_pos, start_button)) {
                         state = STATE_SIMULATING;
+                        simulation_advance(simulation, generations);
+                        simulation_thread_start(&simulation_thread, simulation, target_ups, step_manually, true);
                     }
                 }
 
-                DrawText("Set the starting input using left click.", text_pos.x, text_pos.y, font_size, text_color);
+                DrawText(
+                    "Set the starting input using left click. Zoom with the wheel, pan with right click.",
+                    text_pos.x, text_pos.y, font_size, text_color
+                );
 
                 // Draw Start Button
                 DrawRectangleRec(start_button, GRAY);
@@ -688,19 +7195,23 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
         }
 
         case STATE_SIMULATING: {
+            simulation_thread_poll(&simulation_thread);
+
             BeginDrawing();
             {
                 DRAW_BACKGROUND();
 
+                STATS_BEGIN(STATS_PHASE_DRAW);
                 raylib_draw_grid(
-                    *grid,
-                    grid_padding, grid_padding, grid_padding, grid_padding,
-                    cell_padding,
-                    window_width,
-                    window_height,
+                    &grid_texture,
+                    simulation_thread_grid(&simulation_thread),
+                    simulation_thread_density(&simulation_thread),
+                    viewport,
+                    grid_area,
                     color_scheme,
                     false
                 );
+                STATS_END(STATS_PHASE_DRAW);
 
                 if (show_fps) {
                     DrawFPS(0, 0);
@@ -708,26 +7219,9 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
             }
             EndDrawing();
 
-            if (step_manually) {
-                if (IsKeyDown(KEY_SPACE)) {
-                    step(grid);
-                    WaitTime(0.07);
-                }
-            } else {
-                // Magic timekeeping for a fixed timestep from the raylib examples:
-                // https://www.raylib.com/examples/core/loader.html?name=core_custom_frame_control
-                double current_time_s = GetTime();
-                const double update_draw_time_s = current_time_s - previous_time_s;
-                if (target_ups > 0) {
-                    const double wait_time_s = (1.0f/(float)target_ups) - update_draw_time_s;
-                    if (wait_time_s > 0.0) {
-                        WaitTime((float)wait_time_s);
-                        current_time_s = GetTime();
-
-                        step(grid);
-                    }
-                }
-                previous_time_s = current_time_s;
+            if (step_manually && IsKeyDown(KEY_SPACE)) {
+                simulation_thread_request_step(&simulation_thread);
+                WaitTime(0.07);
             }
 
             break;
@@ -735,6 +7229,11 @@ void run_raylib(Cell_Array_2d *grid, const bool step_manually, const bool show_f
         }
     }
 
+    if (state == STATE_SIMULATING) {
+        simulation_thread_stop(&simulation_thread);
+    }
+    density_pyramid_free(&placing_density);
+    raylib_grid_texture_free(&grid_texture);
     CloseWindow();
 }
 
@@ -744,11 +7243,45 @@ typedef struct {
 
     bool step_manually;
     bool raylib;
+    bool headless;
+    bool bench;
+    bool self_test;
+    bool soup_search;
+    uint64_t first_seed;
+    uint64_t last_seed;
     bool show_fps;
     bool glider_gun;
     Color_Scheme color_scheme;
+    Render_Mode render_mode;
+    Engine engine;
+    size_t thread_count;
+    bool active_tiles;
+    bool wrap;
+    bool detect_cycles;
+    Cycle_Action cycle_action;
+    uint64_t generations;
+    double soup_density;
+    uint64_t seed;
+    Rule rule;
+    bool has_rule;
 
     char *starting_input;
+    char *pattern_file;
+    char *checkpoint_path;
+    uint64_t checkpoint_every;
+    char *resume_path;
+    // 0 for unlimited
+    double ups;
+    bool stats;
+    Stats_Format stats_format;
+    char *metrics_path;
+    char *frame_dir;
+    Frame_Format frame_format;
+    // 0 when --every was not given.
+    uint64_t frame_every;
+    bool drop_frames;
+    int64_t pattern_row;
+    int64_t pattern_col;
 } Config;
 
 Config parse_arguments(const unsigned int argc, char *argv[]) {
@@ -757,10 +7290,42 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
         .grid_cols = 69,
         .step_manually = false,
         .raylib = false,
+        .headless = false,
+        .bench = false,
+        .self_test = false,
+        .soup_search = false,
+        .first_seed = 0,
+        .last_seed = 0,
         .show_fps = false,
         .glider_gun = false,
         .starting_input = "",
+        .pattern_file = NULL,
+        .checkpoint_path = NULL,
+        .checkpoint_every = 0,
+        .resume_path = NULL,
+        .ups = 32,
+        .stats = false,
+        .stats_format = STATS_FORMAT_TABLE,
+        .metrics_path = NULL,
+        .frame_dir = NULL,
+        .frame_format = FRAME_FORMAT_PBM,
+        .frame_every = 0,
+        .drop_frames = false,
+        .pattern_row = 0,
+        .pattern_col = 0,
         .color_scheme = COLOR_SCHEME_DEFAULT,
+        .render_mode = RENDER_MODE_CELLS,
+        .engine = ENGINE_BOOL,
+        .thread_count = 1,
+        .active_tiles = false,
+        .wrap = false,
+        .detect_cycles = false,
+        .cycle_action = CYCLE_ACTION_STOP,
+        .generations = 0,
+        .soup_density = 0,
+        .seed = 1,
+        .rule = RULE_CONWAY,
+        .has_rule = false,
     };
 
     #define PRINT_USAGE()                                                                                           \
@@ -776,22 +7341,117 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
             "    --grid-rows <positive number>\n"                                                                   \
             "    --grid-cols <positive number>\n"                                                                   \
             "\n"                                                                                                    \
+            "    --threads <positive number>\n"                                                                     \
+            "        Step the grid on this many threads, each one computes a band of rows. (default: 1)\n"          \
+            "\n"                                                                                                    \
+            "    --active-tiles\n"                                                                                  \
+            "        Split the grid into 64x64 tiles and only compute tiles that changed or border a changed one.\n"\
+            "        Speeds up grids that are mostly empty or stable.\n"                                            \
+            "\n"                                                                                                    \
+            "    --detect-cycles <stop|fast-forward>\n"                                                              \
+            "        Notice when the grid stops changing or repeats itself with a period of up to 512 generations\n" \
+            "        and report the period and the generation it started at. \"stop\" stops stepping there,\n"      \
+            "        \"fast-forward\" skips whole periods of the remaining --generations. Not for hashlife.\n"        \
+            "\n"                                                                                                    \
+            "    --wrap\n"                                                                                          \
+            "        Connect the opposite edges of the grid like on a torus, instead of everything outside of it\n" \
+            "        being dead. Only for the bool and bitpacked engines.\n"                                         \
+            "\n"                                                                                                    \
             "    --step-manually\n"                                                                                 \
             "        Step manually by pressing SPACE.\n"                                                            \
             "\n"                                                                                                    \
             "    --graphical, --raylib\n"                                                                           \
             "        Display the game using a graphical interface (with Raylib btw).\n"                             \
             "\n"                                                                                                    \
+            "    --headless\n"                                                                                      \
+            "        Run --generations generations as fast as possible without displaying anything and print\n"     \
+            "        the generations and cell updates per second and the final population. Cell updates count\n"    \
+            "        the chunks the sparse engine stepped and are left out for hashlife.\n"                         \
+            "\n"                                                                                                    \
+            "    --bench\n"                                                                                         \
+            "        Run the benchmark matrix of every engine on the built in patterns and random soups of\n"       \
+            "        several sizes and print the median and p99 time per generation as CSV.\n"                      \
+            "        Uses --threads, --active-tiles and --seed.\n"                                                  \
+            "\n"                                                                                                    \
+            "    --self-test\n"                                                                                     \
+            "        Run the built in checks of the engines and exit with an error if one of them fails.\n"         \
+            "\n"                                                                                                    \
+            "    --soup-search\n"                                                                                   \
+            "        Run the random soups of all --seeds on --threads threads until each one turns into still\n"    \
+            "        lifes and oscillators, and print how they ended and the soups per second. Uses --grid-rows,\n" \
+            "        --grid-cols, --soup (default: 0.5), --generations as the limit per soup (default: 10000),\n"  \
+            "        --engine, --rule, --wrap and --active-tiles. Only for the bool and bitpacked engines.\n"       \
+            "\n"                                                                                                    \
+            "    --seeds <first>..<last>\n"                                                                         \
+            "        The seeds of the --soup-search, both included.\n"                                              \
+            "\n"                                                                                                    \
             "    --show-fps\n"                                                                                      \
             "        Show the FPS when rendering using raylib.\n"                                                   \
             "\n"                                                                                                    \
             "    --glider-gun\n"                                                                                    \
             "        Start the game with Gosper's glider gun in the top left.\n"                                    \
             "\n"                                                                                                    \
+            "    --soup <density>\n"                                                                                \
+            "        Start with a random soup where every cell is alive with a probability of <density> (0 to 1).\n"\
+            "\n"                                                                                                    \
+            "    --seed <number>\n"                                                                                 \
+            "        Seed of the random soup. The same seed always gives the same soup. (default: 1)\n"             \
+            "\n"                                                                                                    \
+            "    --generations <number>\n"                                                                          \
+            "        Jump this many generations ahead before showing the game.\n"                                   \
+            "        Use it with \"--engine hashlife\" for jumps of billions of generations.\n"                     \
+            "\n"                                                                                                    \
             "    --starting-input <input>\n"                                                                        \
             "        Specify the starting input in a space and comma separated string like this:"                   \
             "           --starting-input \"<row>,<col> <row>,<col> ...\"\n"                                         \
             "\n"                                                                                                    \
+            "    --rule <rule>\n"                                                                                   \
+            "        The rule in B/S notation, like B36/S23 for HighLife or B2/S for Seeds. (default: B3/S23)\n"    \
+            "        Rules with B0 need the bool or bitpacked engine.\n"                                             \
+            "\n"                                                                                                    \
+            "    --ups <positive number|unlimited>\n"                                                               \
+            "        Generations per second in the terminal and with raylib. (default: 32)\n"                        \
+            "\n"                                                                                                    \
+            "    --stats <table|json>\n"                                                                            \
+            "        Print how long each phase like stepping or rendering took (p50/p99/max), allocations per\n"    \
+            "        generation and the population to stderr on exit and on SIGUSR1.\n"                             \
+            "\n"                                                                                                    \
+            "    --metrics-out <path>\n"                                                                            \
+            "        Write the population, births, deaths, bounding box and step time of every generation to\n"    \
+            "        this file as CSV. Not for hashlife.\n"                                                          \
+            "\n"                                                                                                    \
+            "    --dump-frames <directory>\n"                                                                       \
+            "        Write generations to this directory as images named after their generation, with alive\n"      \
+            "        cells in black. A writer thread encodes them, stepping only waits when it falls 4 frames\n"    \
+            "        behind. Generations skipped by \"--detect-cycles fast-forward\" are not written.\n"            \
+            "\n"                                                                                                    \
+            "    --every <positive number>\n"                                                                       \
+            "        Only write every this many generations to --dump-frames. (default: 1)\n"                       \
+            "\n"                                                                                                    \
+            "    --frame-format <pbm|pgm>\n"                                                                        \
+            "        Binary PBM with 1 bit or PGM with 8 bits per cell. (default: pbm)\n"                           \
+            "\n"                                                                                                    \
+            "    --drop-frames\n"                                                                                   \
+            "        Drop frames while the --dump-frames writer is behind instead of waiting for it.\n"             \
+            "\n"                                                                                                    \
+            "    --checkpoint <path>\n"                                                                             \
+            "        Save a snapshot of the simulation to this file on exit, including CTRL+C and SIGTERM.\n"       \
+            "        Only for the bool and bitpacked engines.\n"                                                    \
+            "\n"                                                                                                    \
+            "    --checkpoint-every <positive number>\n"                                                            \
+            "        Also save the --checkpoint every this many generations.\n"                                     \
+            "\n"                                                                                                    \
+            "    --resume <path>\n"                                                                                 \
+            "        Continue from a snapshot, the grid takes the size of the snapshot. Only for the bool and\n"    \
+            "        bitpacked engines.\n"                                                                          \
+            "\n"                                                                                                    \
+            "    --pattern-file <path>\n"                                                                           \
+            "        Load a pattern from an RLE (.rle) or plaintext (.cells) file.\n"                               \
+            "        Cells outside of the grid are dropped, except with the hashlife and sparse engines.\n"         \
+            "\n"                                                                                                    \
+            "    --pattern-offset <row>,<col>\n"                                                                    \
+            "        Where to put the top left of the --pattern-file, can be negative. (default: 0,0)\n"            \
+            "\n"                                                                                                    \
             "    --color-scheme <color scheme>\n"                                                                   \
             "        Different funky colors.\n"                                                                     \
             "        Available color schemes:\n"                                                                    \
@@ -800,8 +7460,36 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
             printf(                                                                                                 \
             "            %s\n", color_scheme_to_string(color_scheme)                                                \
             );                                                                                                      \
+        }                                                                                                           \
+        printf(                                                                                                     \
+            "\n"                                                                                                    \
+            "    --render <render mode>\n"                                                                          \
+            "        How the terminal shows cells. \"dense\" packs 2x4 cells into a braille character and\n"       \
+            "        \"half-block\" 1x2 cells into a block character, so bigger grids fit on screen.\n"             \
+            "        Available render modes:\n"                                                                     \
+        );                                                                                                          \
+        for (Render_Mode render_mode = RENDER_MODE_CELLS; render_mode < RENDER_MODE_COUNT; render_mode++) {         \
+            printf(                                                                                                 \
+            "            %s\n", render_mode_to_string(render_mode)                                                  \
+            );                                                                                                      \
+        }                                                                                                           \
+        printf(                                                                                                     \
+            "\n"                                                                                                    \
+            "    --engine <engine>\n"                                                                               \
+            "        How the grid is stored and stepped. \"bitpacked\" stores 64 cells per word and is much faster\n"  \
+            "        on big grids. \"hashlife\" and \"sparse\" simulate an unbounded universe with the grid only\n" \
+            "        being the window into it. \"hashlife\" ignores --threads and both ignore --active-tiles.\n"    \
+            "        \"sparse\" only stores 64x64 chunks around alive cells.\n"                                     \
+            "        Available engines:\n"                                                                          \
+        );                                                                                                          \
+        for (Engine engine = ENGINE_BOOL; engine < ENGINE_COUNT; engine++) {                                        \
+            printf(                                                                                                 \
+            "            %s\n", engine_to_string(engine)                                                            \
+            );                                                                                                      \
         }
 
+    // 0..0 are valid seeds, so whether they were given is tracked on the side.
+    bool has_seeds = false;
     for (size_t idx = 0; idx < argc; idx++) {
         const char *arg = argv[idx];
 
@@ -833,6 +7521,34 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
                     config.raylib = true;
                     continue;
                 } else
+                if (strcmp(name, "bench") == 0) {
+                    config.bench = true;
+                    continue;
+                } else
+                if (strcmp(name, "self-test") == 0) {
+                    config.self_test = true;
+                    continue;
+                } else
+                if (strcmp(name, "headless") == 0) {
+                    config.headless = true;
+                    continue;
+                } else
+                if (strcmp(name, "soup-search") == 0) {
+                    config.soup_search = true;
+                    continue;
+                } else
+                if (strcmp(name, "active-tiles") == 0) {
+                    config.active_tiles = true;
+                    continue;
+                } else
+                if (strcmp(name, "wrap") == 0) {
+                    config.wrap = true;
+                    continue;
+                } else
+                if (strcmp(name, "drop-frames") == 0) {
+                    config.drop_frames = true;
+                    continue;
+                } else
                 if (strcmp(name, "glider-gun") == 0) {
                     if (config.grid_rows < 12 || config.grid_cols < 38) {
                         PRINT_ERR(
@@ -878,6 +7594,117 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
 
                     config.grid_cols = atoi(value);
                 } else
+                if (strcmp(name, "threads") == 0) {
+                    const int threads = atoi(value);
+                    if (threads <= 0) {
+                        PRINT_ERR("Threads should be bigger than 0.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.thread_count = threads;
+                } else
+                if (strcmp(name, "soup") == 0) {
+                    char *end = NULL;
+                    const double density = strtod(value, &end);
+                    if (end == value || *end != '\0' || density <= 0 || density > 1) {
+                        PRINT_ERR("Soup density should be a number bigger than 0 and at most 1.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.soup_density = density;
+                } else
+                if (strcmp(name, "seed") == 0) {
+                    char *end = NULL;
+                    const unsigned long long seed = strtoull(value, &end, 10);
+                    if (end == value || *end != '\0' || value[0] == '-') {
+                        PRINT_ERR("Seed should be a positive number.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.seed = seed;
+                } else
+                if (strcmp(name, "generations") == 0) {
+                    char *end = NULL;
+                    const unsigned long long generations = strtoull(value, &end, 10);
+                    if (end == value || *end != '\0' || value[0] == '-') {
+                        PRINT_ERR("Generations should be a positive number.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.generations = generations;
+                } else
+                if (strcmp(name, "seeds") == 0) {
+                    char end = '\0';
+                    if (strchr(value, '-') != NULL
+                        || sscanf(value, "%" SCNu64 "..%" SCNu64 "%c", &config.first_seed, &config.last_seed, &end) != 2
+                        || config.first_seed > config.last_seed
+                        || config.last_seed == UINT64_MAX
+                    ) {
+                        PRINT_ERR("Seeds should look like <first>..<last> with first <= last.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                    has_seeds = true;
+                } else
+                if (strcmp(name, "metrics-out") == 0) {
+                    config.metrics_path = value;
+                } else
+                if (strcmp(name, "dump-frames") == 0) {
+                    config.frame_dir = value;
+                } else
+                if (strcmp(name, "every") == 0) {
+                    char *end = NULL;
+                    const unsigned long long frame_every = strtoull(value, &end, 10);
+                    if (end == value || *end != '\0' || value[0] == '-' || frame_every == 0) {
+                        PRINT_ERR("Frame interval should be a positive number.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.frame_every = frame_every;
+                } else
+                if (strcmp(name, "frame-format") == 0) {
+                    bool found = false;
+                    for (Frame_Format format = FRAME_FORMAT_PBM; format < FRAME_FORMAT_COUNT; format++) {
+                        if (strcmp(value, frame_format_to_string(format)) == 0) {
+                            config.frame_format = format;
+                            found = true;
+                        }
+                    }
+
+                    if (!found) {
+                        PRINT_ERR("Invalid frame format \"%s\"!\n", value);
+                        PRINT_ERR("Valid frame formats are:\n");
+                        for (Frame_Format format = FRAME_FORMAT_PBM; format < FRAME_FORMAT_COUNT; format++) {
+                            PRINT_ERR("\t%s\n", frame_format_to_string(format));
+                        }
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                } else
+                if (strcmp(name, "checkpoint") == 0) {
+                    config.checkpoint_path = value;
+                } else
+                if (strcmp(name, "checkpoint-every") == 0) {
+                    char *end = NULL;
+                    const unsigned long long checkpoint_every = strtoull(value, &end, 10);
+                    if (end == value || *end != '\0' || value[0] == '-' || checkpoint_every == 0) {
+                        PRINT_ERR("Checkpoint interval should be a positive number.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+
+                    config.checkpoint_every = checkpoint_every;
+                } else
+                if (strcmp(name, "resume") == 0) {
+                    config.resume_path = value;
+                } else
+                if (strcmp(name, "pattern-file") == 0) {
+                    config.pattern_file = value;
+                } else
+                if (strcmp(name, "pattern-offset") == 0) {
+                    char end = '\0';
+                    if (sscanf(value, "%" SCNd64 ",%" SCNd64 "%c", &config.pattern_row, &config.pattern_col, &end) != 2) {
+                        PRINT_ERR("Pattern offset should look like <row>,<col>.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                } else
                 if (strcmp(name, "starting-input") == 0) {
                     config.starting_input = value;
                 } else
@@ -898,72 +7725,295 @@ Config parse_arguments(const unsigned int argc, char *argv[]) {
                         }
                         exit(EX_ARGUMENT_PARSE_ERROR);
                     }
+                } else
+                if (strcmp(name, "detect-cycles") == 0) {
+                    bool found = false;
+                    for (Cycle_Action action = CYCLE_ACTION_STOP; action < CYCLE_ACTION_COUNT; action++) {
+                        if (strcmp(value, cycle_action_to_string(action)) == 0) {
+                            config.cycle_action = action;
+                            found = true;
+                        }
+                    }
+
+                    if (!found) {
+                        PRINT_ERR("Invalid cycle action \"%s\"!\n", value);
+                        PRINT_ERR("Valid cycle actions are:\n");
+                        for (Cycle_Action action = CYCLE_ACTION_STOP; action < CYCLE_ACTION_COUNT; action++) {
+                            PRINT_ERR("\t%s\n", cycle_action_to_string(action));
+                        }
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                    config.detect_cycles = true;
+                } else
+                if (strcmp(name, "rule") == 0) {
+                    if (!rule_parse(value, &config.rule)) {
+                        PRINT_ERR("Invalid rule \"%s\", it should look like B3/S23.\n", value);
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                    config.has_rule = true;
+                } else
+                if (strcmp(name, "ups") == 0) {
+                    if (strcmp(value, "unlimited") == 0) {
+                        config.ups = 0;
+                    } else {
+                        char *end = NULL;
+                        const double ups = strtod(value, &end);
+                        if (end == value || *end != '\0' || !(ups > 0)) {
+                            PRINT_ERR("Updates per second should be a positive number or \"unlimited\".\n");
+                            exit(EX_ARGUMENT_PARSE_ERROR);
+                        }
+                        config.ups = ups;
+                    }
+                } else
+                if (strcmp(name, "stats") == 0) {
+                    bool found = false;
+                    for (Stats_Format format = STATS_FORMAT_TABLE; format < STATS_FORMAT_COUNT; format++) {
+                        if (strcmp(value, stats_format_to_string(format)) == 0) {
+                            config.stats_format = format;
+                            found = true;
+                        }
+                    }
+
+                    if (!found) {
+                        PRINT_ERR("Invalid stats format \"%s\"!\n", value);
+                        PRINT_ERR("Valid stats formats are:\n");
+                        for (Stats_Format format = STATS_FORMAT_TABLE; format < STATS_FORMAT_COUNT; format++) {
+                            PRINT_ERR("\t%s\n", stats_format_to_string(format));
+                        }
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                    if (!ENABLE_STATS) {
+                        PRINT_ERR("--stats needs a build with ENABLE_STATS.\n");
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                    config.stats = true;
+                } else
+                if (strcmp(name, "render") == 0) {
+                    bool found = false;
+                    for (Render_Mode render_mode = RENDER_MODE_CELLS; render_mode < RENDER_MODE_COUNT; render_mode++) {
+                        if (strcmp(value, render_mode_to_string(render_mode)) == 0) {
+                            config.render_mode = render_mode;
+                            found = true;
+                        }
+                    }
+
+                    if (!found) {
+                        PRINT_ERR("Invalid render mode \"%s\"!\n", value);
+                        PRINT_ERR("Valid render modes are:\n");
+                        for (Render_Mode render_mode = RENDER_MODE_CELLS; render_mode < RENDER_MODE_COUNT; render_mode++) {
+                            PRINT_ERR("\t%s\n", render_mode_to_string(render_mode));
+                        }
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
+                } else
+                if (strcmp(name, "engine") == 0) {
+                    bool found = false;
+                    for (Engine engine = ENGINE_BOOL; engine < ENGINE_COUNT; engine++) {
+                        if (strcmp(value, engine_to_string(engine)) == 0) {
+                            config.engine = engine;
+                            found = true;
+                        }
+                    }
+
+                    if (!found) {
+                        PRINT_ERR("Invalid engine \"%s\"!\n", value);
+                        PRINT_ERR("Valid engines are:\n");
+                        for (Engine engine = ENGINE_BOOL; engine < ENGINE_COUNT; engine++) {
+                            PRINT_ERR("\t%s\n", engine_to_string(engine));
+                        }
+                        exit(EX_ARGUMENT_PARSE_ERROR);
+                    }
                 }
             }
         }
     }
 
+    if (config.checkpoint_every != 0 && config.checkpoint_path == NULL) {
+        PRINT_ERR("--checkpoint-every needs a --checkpoint file to write to.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if ((config.frame_every != 0 || config.frame_format != FRAME_FORMAT_PBM || config.drop_frames) && config.frame_dir == NULL) {
+        PRINT_ERR("--every, --frame-format and --drop-frames need a --dump-frames directory to write to.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.headless && config.generations == 0) {
+        PRINT_ERR("Running headless needs the number of --generations to run.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.detect_cycles && config.engine == ENGINE_HASHLIFE) {
+        PRINT_ERR("--detect-cycles does not work with the hashlife engine, it can not hash generations one by one.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.soup_search != has_seeds) {
+        PRINT_ERR("--soup-search and --seeds only work together.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.soup_search && config.engine != ENGINE_BOOL && config.engine != ENGINE_BITPACKED) {
+        PRINT_ERR("--soup-search needs a bounded grid, the %s engine has none.\n", engine_to_string(config.engine));
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.metrics_path != NULL && config.engine == ENGINE_HASHLIFE) {
+        PRINT_ERR("--metrics-out does not work with the hashlife engine, it does not step generations one by one.\n");
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    if (config.wrap && config.engine != ENGINE_BOOL && config.engine != ENGINE_BITPACKED) {
+        PRINT_ERR("--wrap needs a bounded grid, the %s engine has none.\n", engine_to_string(config.engine));
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    // A snapshot is a bounded grid, it would silently drop everything outside of the window.
+    if ((config.checkpoint_path != NULL || config.resume_path != NULL)
+        && config.engine != ENGINE_BOOL && config.engine != ENGINE_BITPACKED
+    ) {
+        PRINT_ERR("--checkpoint and --resume need a bounded grid, the %s engine has none.\n", engine_to_string(config.engine));
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
     return config;
 }
 
 int32_t main(const int argc, char *argv[]) {
     const Config config = parse_arguments(argc, argv);
-    Cell_Array_2d grid = cell_array_init(config.grid_rows, config.grid_cols);
+    rule_select(config.rule);
+    row_kernel_select();
+
+    if (config.bench) {
+        run_bench(config.thread_count, config.active_tiles, config.seed);
+        return EX_OK;
+    }
+
+    if (config.self_test) {
+        return run_self_test() ? EX_OK : EX_SELF_TEST_FAILED;
+    }
+
+    if (config.soup_search) {
+        run_soup_search(
+            config.grid_rows, config.grid_cols,
+            config.engine,
+            config.soup_density > 0 ? config.soup_density : SOUP_SEARCH_DEFAULT_DENSITY,
+            config.generations > 0 ? config.generations : SOUP_SEARCH_DEFAULT_GENERATIONS,
+            config.first_seed, config.last_seed,
+            config.thread_count,
+            config.active_tiles,
+            config.wrap
+        );
+        return EX_OK;
+    }
+
+#if ENABLE_STATS
+    if (config.stats) {
+        stats_enable(config.stats_format);
+    }
+#endif
+
+    // A resumed simulation has the size of its snapshot.
+    Snapshot snapshot = {0};
+    size_t grid_rows = config.grid_rows;
+    size_t grid_cols = config.grid_cols;
+    if (config.resume_path != NULL) {
+        snapshot = snapshot_open(config.resume_path);
+        grid_rows = snapshot.header->rows;
+        grid_cols = snapshot.header->cols;
+
+        // A resumed simulation keeps the rule of its snapshot unless it is given explicitly.
+        const Rule snapshot_rule = { .birth = snapshot.header->birth, .survival = snapshot.header->survival };
+        if (!rule_equals(snapshot_rule, life_rule)) {
+            if (config.has_rule) {
+                char rule[RULE_STRING_SIZE];
+                rule_to_string(snapshot_rule, rule);
+                PRINT_ERR("\"%s\" was saved with the rule %s!\n", config.resume_path, rule);
+                exit(EX_SNAPSHOT_ERROR);
+            }
+            rule_select(snapshot_rule);
+            row_kernel_select();
+        }
+    }
+
+    if (!rule_keeps_empty_dead(life_rule) && (config.engine == ENGINE_HASHLIFE || config.engine == ENGINE_SPARSE)) {
+        PRINT_ERR("Rules with B0 bring empty space to life, which the %s engine can not represent.\n",
+            engine_to_string(config.engine));
+        exit(EX_ARGUMENT_PARSE_ERROR);
+    }
+
+    Simulation simulation = simulation_init(
+        grid_rows, grid_cols,
+        config.engine,
+        config.thread_count,
+        config.active_tiles,
+        config.wrap
+    );
+    simulation.checkpoint_path = config.checkpoint_path;
+    simulation.checkpoint_every = config.checkpoint_every;
+    if (config.detect_cycles) {
+        simulation_detect_cycles(&simulation, config.cycle_action);
+    }
+    if (config.metrics_path != NULL) {
+        simulation_write_metrics(&simulation, config.metrics_path);
+    }
+    if (config.frame_dir != NULL) {
+        simulation_dump_frames(
+            &simulation,
+            config.frame_dir,
+            config.frame_format,
+            config.frame_every != 0 ? config.frame_every : 1,
+            config.drop_frames
+        );
+    }
+    if (config.resume_path != NULL) {
+        simulation_load_snapshot(&simulation, snapshot);
+    }
+    if (config.soup_density > 0) {
+        simulation_fill_soup(&simulation, config.seed, config.soup_density);
+    }
+    if (config.pattern_file != NULL) {
+        simulation_load_pattern_file(&simulation, config.pattern_file, config.pattern_row, config.pattern_col);
+    }
     if (strcmp(config.starting_input, "") != 0) {
-        set_starting_input(&grid, config.starting_input, strlen(config.starting_input));
+        set_starting_input(&simulation, config.starting_input, strlen(config.starting_input));
     }
 
     // Init default grid pattern
     if (config.glider_gun) {
-        cell_array_set(&grid, 5,  1, true);
-        cell_array_set(&grid, 5,  2, true);
-        cell_array_set(&grid, 6,  1, true);
-        cell_array_set(&grid, 6,  2, true);
-
-        cell_array_set(&grid, 3, 13, true);
-        cell_array_set(&grid, 3, 14, true);
-        cell_array_set(&grid, 4, 12, true);
-        cell_array_set(&grid, 4, 16, true);
-        cell_array_set(&grid, 5, 11, true);
-        cell_array_set(&grid, 5, 17, true);
-        cell_array_set(&grid, 6, 11, true);
-        cell_array_set(&grid, 6, 15, true);
-        cell_array_set(&grid, 6, 17, true);
-        cell_array_set(&grid, 6, 18, true);
-        cell_array_set(&grid, 7, 17, true);
-        cell_array_set(&grid, 7, 11, true);
-        cell_array_set(&grid, 8, 12, true);
-        cell_array_set(&grid, 8, 16, true);
-        cell_array_set(&grid, 9, 13, true);
-        cell_array_set(&grid, 9, 14, true);
-
-        cell_array_set(&grid, 1, 25, true);
-        cell_array_set(&grid, 2, 23, true);
-        cell_array_set(&grid, 2, 25, true);
-        cell_array_set(&grid, 3, 21, true);
-        cell_array_set(&grid, 3, 22, true);
-        cell_array_set(&grid, 4, 21, true);
-        cell_array_set(&grid, 4, 22, true);
-        cell_array_set(&grid, 5, 21, true);
-        cell_array_set(&grid, 5, 22, true);
-        cell_array_set(&grid, 6, 23, true);
-        cell_array_set(&grid, 6, 25, true);
-        cell_array_set(&grid, 7, 25, true);
-
-        cell_array_set(&grid, 3, 35, true);
-        cell_array_set(&grid, 3, 36, true);
-        cell_array_set(&grid, 4, 35, true);
-        cell_array_set(&grid, 4, 36, true);
+        simulation_place_pattern(&simulation, &PATTERNS[PATTERN_GLIDER_GUN], 0, 0);
     }
 
+    if (config.headless) {
+        run_headless(&simulation, config.generations, config.thread_count);
+    } else
     if (config.raylib) {
-        run_raylib(&grid, config.step_manually, config.show_fps, config.color_scheme);
+        run_raylib(&simulation, config.step_manually, config.show_fps, config.color_scheme, config.ups, config.generations);
     } else {
-        run_terminal(&grid, config.step_manually, config.color_scheme);
+        run_terminal(
+            &simulation,
+            config.step_manually,
+            config.color_scheme,
+            config.render_mode,
+            config.ups,
+            config.generations
+        );
+    }
+    simulation_print_cycle(&simulation);
+    simulation_print_frames(&simulation);
+
+    // Also reached after SIGINT or SIGTERM, which stop the frontends, so long runs are not lost.
+    if (config.checkpoint_path != NULL) {
+        simulation_save_snapshot(&simulation, config.checkpoint_path);
+    }
+#if ENABLE_STATS
+    if (config.stats) {
+        stats_report(&simulation);
     }
+#endif
 
     // Free Grid memory
-    cell_array_free(grid);
+    simulation_free(&simulation);
 
     return EX_OK;
 }